@@ -7,6 +7,8 @@
 #include <cstdlib>
 #endif // _WIN32
 
+#include <optional>
+
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
@@ -55,22 +57,46 @@ void DataReader(void* payload, uint32_t code, OCG_CardData* data)
 	data->setcodes = reinterpret_cast<uint16_t*>(hss->bytes.data() + sizeof(OCG_CardData));
 }
 
-int ScriptReader(void* payload, OCG_Duel duel, const char* name)
+// Asks multirole for a script (or its precompiled bytecode) and loads it,
+// returns nothing if multirole has no such script.
+std::optional<int> ReadAndLoadScript(void* payload, OCG_Duel duel, const char* name, Ignis::Hornet::ScriptKind kind)
 {
 	const std::size_t nameSz = std::strlen(name) + 1U;
 	auto* wptr = hss->bytes.data();
 	Write<void*>(wptr, payload);
+	Write<Ignis::Hornet::ScriptKind>(wptr, kind);
 	Write<std::size_t>(wptr, nameSz);
 	std::memcpy(wptr, name, nameSz);
 	NotifyAndWait(Ignis::Hornet::Action::CB_SCRIPT_READER);
 	const auto* rptr = hss->bytes.data();
 	const auto size = Read<std::size_t>(rptr);
 	if(size == 0U)
-		return 0;
+		return std::nullopt;
 	const char* data = reinterpret_cast<const char*>(rptr);
 	return OCG_LoadScript(duel, data, size, name);
 }
 
+int ScriptReader(void* payload, OCG_Duel duel, const char* name)
+{
+	using Ignis::Hornet::ScriptKind;
+	// Whether the core is given precompiled scripts, decided the first
+	// time a script is needed by loading an empty precompiled chunk. Once
+	// accepted, a failure loading a script is an error of the script itself
+	// and it must not be run again from source.
+	static std::optional<bool> useBytecode;
+	if(!useBytecode)
+	{
+		const auto r = ReadAndLoadScript(payload, duel, "probe", ScriptKind::BYTECODE_PROBE);
+		useBytecode = r.value_or(0) != 0;
+	}
+	if(*useBytecode)
+	{
+		if(const auto r = ReadAndLoadScript(payload, duel, name, ScriptKind::BYTECODE); r)
+			return *r;
+	}
+	return ReadAndLoadScript(payload, duel, name, ScriptKind::SOURCE).value_or(0);
+}
+
 void LogHandler(void* payload, const char* str, int t)
 {
 	const std::size_t strSz = std::strlen(str) + 1U;
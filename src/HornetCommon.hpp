@@ -40,6 +40,14 @@ enum class Action : uint8_t
 	CB_DONE, // Callbacks: doesn't apply
 };
 
+// What CB_SCRIPT_READER asks for.
+enum class ScriptKind : uint8_t
+{
+	SOURCE = 0U,
+	BYTECODE,
+	BYTECODE_PROBE, // See Core::IScriptSupplier, the name is ignored.
+};
+
 struct SharedSegment
 {
 	ipc::interprocess_mutex mtx;
@@ -0,0 +1,659 @@
+// Synthetic load for capacity planning: keeps many rooms open against a
+// running multirole, each one played by a pair of simulated clients that
+// answer with the responses of a saved replay.
+//
+// Usage: load-generator <host> <port> <replays dir> <rooms> <seconds> [think time ms] [threads]
+// Replays (*.yrpX) must be single files, as written by replay-extractor, and
+// only 1v1 duels are used. Rooms are opened gradually during the first few
+// seconds, and whenever a room finishes a new one is opened with the next
+// replay, until the given number of seconds elapses. Responses are sent
+// after a think time drawn from a log-normal distribution with the given
+// median (1000ms by default, 0 answers right away).
+//
+// Decks are given in the order they were recorded with shuffling disabled,
+// but the server picks its own seed, so the duel only goes as recorded
+// until something random happens. From then on responses are eventually
+// rejected and the server ends the duel, which is reported as diverged.
+//
+// Every client connects from the same address, so the server should have
+// lobbyMaxConnections disabled.
+//
+// Reports the latency between each message and the server's reaction to it,
+// by message: CREATE_GAME, JOIN_GAME and TRY_START until acknowledged,
+// TURN_CHOICE until the duel starts, each response (by the request it
+// answers) until the next core message and MSG_WIN until the replay arrives.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "../Multirole/YGOPro/Config.hpp"
+#include "../Multirole/YGOPro/Constants.hpp"
+#include "../Multirole/YGOPro/CoreUtils.hpp"
+#include "../Multirole/YGOPro/CTOSMsg.hpp"
+#include "../Multirole/YGOPro/ReplayReader.hpp"
+#include "../Multirole/YGOPro/STOCMsg.hpp"
+
+using Bytes = std::vector<uint8_t>;
+using Clock = std::chrono::steady_clock;
+using ReplayPtr = std::shared_ptr<const YGOPro::ReplayReader>;
+using boost::asio::ip::tcp;
+using YGOPro::CTOSMsg;
+using YGOPro::STOCMsg;
+
+constexpr auto RAMP_UP = std::chrono::seconds(10);
+constexpr auto RETRY_DELAY = std::chrono::seconds(1);
+constexpr auto MAX_THINK_TIME = std::chrono::seconds(60);
+constexpr double THINK_TIME_SIGMA = 1.0;
+
+const char* RequestName(uint8_t msgType)
+{
+	switch(msgType)
+	{
+#define X(m) case m: return #m
+	X(MSG_SELECT_CARD);
+	X(MSG_SELECT_TRIBUTE);
+	X(MSG_SELECT_UNSELECT_CARD);
+	X(MSG_SELECT_BATTLECMD);
+	X(MSG_SELECT_IDLECMD);
+	X(MSG_SELECT_EFFECTYN);
+	X(MSG_SELECT_YESNO);
+	X(MSG_SELECT_OPTION);
+	X(MSG_SELECT_CHAIN);
+	X(MSG_SELECT_PLACE);
+	X(MSG_SELECT_DISFIELD);
+	X(MSG_SELECT_POSITION);
+	X(MSG_SORT_CARD);
+	X(MSG_SORT_CHAIN);
+	X(MSG_SELECT_COUNTER);
+	X(MSG_SELECT_SUM);
+	X(MSG_ROCK_PAPER_SCISSORS);
+	X(MSG_ANNOUNCE_RACE);
+	X(MSG_ANNOUNCE_ATTRIB);
+	X(MSG_ANNOUNCE_CARD);
+	X(MSG_ANNOUNCE_NUMBER);
+	X(MSG_ANNOUNCE_CARD_FILTER);
+#undef X
+	default: return "MSG_UNKNOWN";
+	}
+}
+
+template<std::size_t N>
+void StrToUtf16Buffer(std::string_view str, uint16_t (&buffer)[N])
+{
+	const std::size_t n = std::min(str.size(), N - 1U);
+	for(std::size_t i = 0U; i < n; i++)
+		buffer[i] = static_cast<uint8_t>(str[i]);
+	buffer[n] = 0U;
+}
+
+template<typename T>
+Bytes MakeCTOSMsg(CTOSMsg::MsgType type, const T& body)
+{
+	Bytes msg(CTOSMsg::HEADER_LENGTH + sizeof(T));
+	const auto length = static_cast<CTOSMsg::LengthType>(sizeof(type) + sizeof(T));
+	std::memcpy(msg.data(), &length, sizeof(length));
+	std::memcpy(msg.data() + sizeof(length), &type, sizeof(type));
+	std::memcpy(msg.data() + CTOSMsg::HEADER_LENGTH, &body, sizeof(T));
+	return msg;
+}
+
+Bytes MakeCTOSMsg(CTOSMsg::MsgType type, const uint8_t* data = nullptr, std::size_t size = 0U)
+{
+	Bytes msg(CTOSMsg::HEADER_LENGTH + size);
+	const auto length = static_cast<CTOSMsg::LengthType>(sizeof(type) + size);
+	std::memcpy(msg.data(), &length, sizeof(length));
+	std::memcpy(msg.data() + sizeof(length), &type, sizeof(type));
+	if(size != 0U)
+		std::memcpy(msg.data() + CTOSMsg::HEADER_LENGTH, data, size);
+	return msg;
+}
+
+// NOTE: The server gives the decks to the core in reverse order when not
+// shuffling, so the recorded order is reversed back.
+Bytes MakeUpdateDeck(const YGOPro::Replay::Duelist& duelist)
+{
+	std::vector<uint32_t> codes(duelist.main.rbegin(), duelist.main.rend());
+	codes.insert(codes.end(), duelist.extra.begin(), duelist.extra.end());
+	const std::array<uint32_t, 2U> counts{static_cast<uint32_t>(codes.size()), 0U};
+	Bytes body(sizeof(counts) + codes.size() * sizeof(uint32_t));
+	std::memcpy(body.data(), counts.data(), sizeof(counts));
+	std::memcpy(body.data() + sizeof(counts), codes.data(), codes.size() * sizeof(uint32_t));
+	return MakeCTOSMsg(CTOSMsg::MsgType::UPDATE_DECK, body.data(), body.size());
+}
+
+// Latencies and counters of all the rooms.
+class Stats
+{
+public:
+	std::atomic<std::size_t> rooms{0U};
+	std::atomic<std::size_t> duels{0U};
+	std::atomic<std::size_t> diverged{0U};
+	std::atomic<std::size_t> responses{0U};
+	std::atomic<std::size_t> errors{0U};
+
+	void Record(const char* label, Clock::duration d)
+	{
+		using namespace std::chrono;
+		const auto us = static_cast<uint32_t>(duration_cast<microseconds>(d).count());
+		std::scoped_lock lock(mLatencies);
+		latencies[label].push_back(us);
+	}
+
+	void Print(std::chrono::seconds elapsed)
+	{
+		std::scoped_lock lock(mLatencies);
+		std::printf("%zu rooms, %zu duels (%zu diverged), %zu responses (%.1f/s), %zu errors.\n",
+			rooms.load(), duels.load(), diverged.load(), responses.load(),
+			static_cast<double>(responses.load()) / elapsed.count(), errors.load());
+		std::printf("%-28s %10s %10s %10s %10s %10s %10s\n",
+			"Latency (ms)", "count", "p50", "p90", "p99", "p99.9", "max");
+		for(auto& kv : latencies)
+		{
+			auto& v = kv.second;
+			std::sort(v.begin(), v.end());
+			auto Percentile = [&v](double p)
+			{
+				const auto i = static_cast<std::size_t>(std::ceil(p * v.size()));
+				return v[std::max<std::size_t>(i, 1U) - 1U] / 1000.0;
+			};
+			std::printf("%-28s %10zu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+				kv.first.data(), v.size(), Percentile(0.5), Percentile(0.9),
+				Percentile(0.99), Percentile(0.999), v.back() / 1000.0);
+		}
+	}
+private:
+	std::map<std::string, std::vector<uint32_t>> latencies;
+	std::mutex mLatencies;
+};
+
+struct Options
+{
+	tcp::resolver::results_type endpoints;
+	std::vector<ReplayPtr> replays;
+	std::chrono::milliseconds thinkTime;
+};
+
+class Generator
+{
+public:
+	Stats stats;
+
+	Generator(boost::asio::io_context& ioCtx, Options&& opts) :
+		ioCtx(ioCtx),
+		opts(std::move(opts)),
+		nextReplay(0U),
+		stopped(false)
+	{}
+
+	boost::asio::io_context& IoContext()
+	{
+		return ioCtx;
+	}
+
+	const Options& Opts() const
+	{
+		return opts;
+	}
+
+	// Opens a room with the next replay, unless the run is over.
+	void OpenRoom();
+
+	void Stop()
+	{
+		stopped = true;
+		ioCtx.stop();
+	}
+private:
+	boost::asio::io_context& ioCtx;
+	const Options opts;
+	std::atomic<std::size_t> nextReplay;
+	std::atomic<bool> stopped;
+};
+
+// A room hosted by one simulated client and joined by another, each one
+// sending the responses of the replay as the server requests them. Both
+// connections are handled on the room's strand.
+class Room final : public std::enable_shared_from_this<Room>
+{
+public:
+	Room(Generator& gen, ReplayPtr replay) :
+		gen(gen),
+		replay(std::move(replay)),
+		strand(gen.IoContext().get_executor()),
+		duelists{Duelist(strand), Duelist(strand)},
+		rng(std::random_device{}()),
+		nextResponse(0U),
+		readyCount(0U),
+		finished(false)
+	{}
+
+	void Start()
+	{
+		Connect(HOST);
+	}
+private:
+	enum : std::size_t
+	{
+		HOST = 0U,
+		GUEST = 1U,
+	};
+
+	using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+	struct Duelist
+	{
+		tcp::socket socket;
+		boost::asio::steady_timer timer;
+		std::array<uint8_t, sizeof(STOCMsg::LengthType) + sizeof(STOCMsg::MsgType)> header{};
+		Bytes body;
+		std::queue<Bytes> outgoing;
+
+		explicit Duelist(Strand& strand) : socket(strand), timer(strand)
+		{}
+	};
+
+	// A message whose latency is being measured, until the server sends the
+	// expected message back to any of the duelists. There is at most one
+	// probe waiting for each type of message.
+	struct Probe
+	{
+		const char* label;
+		STOCMsg::MsgType expected;
+		Clock::time_point sent;
+	};
+
+	Generator& gen;
+	const ReplayPtr replay;
+	Strand strand;
+	std::array<Duelist, 2U> duelists;
+	std::mt19937 rng;
+	std::vector<Probe> probes;
+	std::size_t nextResponse;
+	int readyCount;
+	bool finished;
+
+	void Connect(std::size_t i)
+	{
+		auto self(shared_from_this());
+		boost::asio::async_connect(duelists[i].socket, gen.Opts().endpoints,
+		[this, self, i](boost::system::error_code ec, const tcp::endpoint& /*unused*/)
+		{
+			if(ec)
+				return Finish(true);
+			CTOSMsg::PlayerInfo pi{};
+			StrToUtf16Buffer((i == HOST) ? "LoadHost" : "LoadGuest", pi.name);
+			Send(i, MakeCTOSMsg(CTOSMsg::MsgType::PLAYER_INFO, pi));
+			if(i == HOST)
+			{
+				CTOSMsg::CreateGame cg{};
+				auto& hi = cg.hostInfo;
+				const uint64_t flags = replay->DuelFlags();
+				hi.allowed = YGOPro::ALLOWED_CARDS_ANY;
+				hi.dontCheckDeck = 1U;
+				hi.dontShuffleDeck = 1U;
+				hi.startingLP = replay->StartingLP();
+				hi.startingDrawCount = static_cast<uint8_t>(replay->StartingDrawCount());
+				hi.drawCountPerTurn = static_cast<uint8_t>(replay->DrawCountPerTurn());
+				hi.duelFlagsHigh = static_cast<uint32_t>(flags >> 32U);
+				hi.duelFlagsLow = static_cast<uint32_t>(flags);
+				hi.handshake = YGOPro::SERVER_HANDSHAKE;
+				hi.version = YGOPro::SERVER_VERSION;
+				hi.t0Count = hi.t1Count = hi.bestOf = 1;
+				StrToUtf16Buffer("load-generator", cg.name);
+				Send(i, MakeCTOSMsg(CTOSMsg::MsgType::CREATE_GAME, cg), "CREATE_GAME", STOCMsg::MsgType::CREATE_GAME);
+			}
+			else
+			{
+				CTOSMsg::JoinGame jg{};
+				jg.id = roomId;
+				jg.version = YGOPro::SERVER_VERSION;
+				Send(i, MakeCTOSMsg(CTOSMsg::MsgType::JOIN_GAME, jg), "JOIN_GAME", STOCMsg::MsgType::JOIN_GAME);
+			}
+			Send(i, MakeUpdateDeck(replay->Duelists()[i].front()));
+			Send(i, MakeCTOSMsg(CTOSMsg::MsgType::READY));
+			DoReadHeader(i);
+		});
+	}
+
+	void Send(std::size_t i, Bytes&& msg, const char* label = nullptr, STOCMsg::MsgType expected = {})
+	{
+		if(label != nullptr)
+			StartProbe(label, expected);
+		auto& d = duelists[i];
+		const bool writeInProgress = !d.outgoing.empty();
+		d.outgoing.push(std::move(msg));
+		if(!writeInProgress)
+			DoWrite(i);
+	}
+
+	void StartProbe(const char* label, STOCMsg::MsgType expected)
+	{
+		auto it = std::find_if(probes.begin(), probes.end(), [expected](const Probe& p)
+		{
+			return p.expected == expected;
+		});
+		if(it == probes.end())
+			it = probes.emplace(probes.end());
+		*it = Probe{label, expected, Clock::now()};
+	}
+
+	void DoWrite(std::size_t i)
+	{
+		auto self(shared_from_this());
+		auto& d = duelists[i];
+		boost::asio::async_write(d.socket, boost::asio::buffer(d.outgoing.front()),
+		[this, self, i](boost::system::error_code ec, std::size_t /*unused*/)
+		{
+			if(ec)
+				return Finish(true);
+			auto& d = duelists[i];
+			d.outgoing.pop();
+			if(!d.outgoing.empty())
+				DoWrite(i);
+		});
+	}
+
+	void DoReadHeader(std::size_t i)
+	{
+		auto self(shared_from_this());
+		auto& d = duelists[i];
+		boost::asio::async_read(d.socket, boost::asio::buffer(d.header),
+		[this, self, i](boost::system::error_code ec, std::size_t /*unused*/)
+		{
+			STOCMsg::LengthType length{};
+			std::memcpy(&length, duelists[i].header.data(), sizeof(length));
+			if(ec || length == 0U)
+				return Finish(true);
+			DoReadBody(i, length - sizeof(STOCMsg::MsgType));
+		});
+	}
+
+	void DoReadBody(std::size_t i, std::size_t length)
+	{
+		auto self(shared_from_this());
+		auto& d = duelists[i];
+		d.body.resize(length);
+		boost::asio::async_read(d.socket, boost::asio::buffer(d.body),
+		[this, self, i](boost::system::error_code ec, std::size_t /*unused*/)
+		{
+			if(ec)
+				return Finish(true);
+			const auto type = static_cast<STOCMsg::MsgType>(duelists[i].header.back());
+			HandleMsg(i, type, duelists[i].body);
+			if(!finished)
+				DoReadHeader(i);
+		});
+	}
+
+	void HandleMsg(std::size_t i, STOCMsg::MsgType type, const Bytes& body)
+	{
+		auto it = std::find_if(probes.begin(), probes.end(), [type](const Probe& p)
+		{
+			return p.expected == type;
+		});
+		if(it != probes.end())
+		{
+			gen.stats.Record(it->label, Clock::now() - it->sent);
+			probes.erase(it);
+		}
+		switch(type)
+		{
+		case STOCMsg::MsgType::CREATE_GAME:
+		{
+			STOCMsg::CreateGame cg{};
+			if(body.size() < sizeof(cg))
+				return Finish(true);
+			std::memcpy(&cg, body.data(), sizeof(cg));
+			roomId = cg.id;
+			Connect(GUEST);
+			break;
+		}
+		case STOCMsg::MsgType::PLAYER_CHANGE:
+		{
+			constexpr uint8_t PCHANGE_TYPE_READY = 0x9U;
+			// NOTE: Only the host starts the duel once both are ready.
+			if(i == HOST && !body.empty() && (body[0U] & 0xFU) == PCHANGE_TYPE_READY &&
+			   ++readyCount == 2)
+				Send(HOST, MakeCTOSMsg(CTOSMsg::MsgType::TRY_START), "TRY_START", STOCMsg::MsgType::DUEL_START);
+			break;
+		}
+		case STOCMsg::MsgType::CHOOSE_RPS:
+		{
+			// NOTE: The host always wins (rock against scissors) and goes first,
+			// so the team of each duelist is the same as recorded.
+			const CTOSMsg::RPSChoice choice{static_cast<uint8_t>((i == HOST) ? 2U : 1U)};
+			Send(i, MakeCTOSMsg(CTOSMsg::MsgType::RPS_CHOICE, choice));
+			break;
+		}
+		case STOCMsg::MsgType::CHOOSE_ORDER:
+		{
+			const CTOSMsg::TurnChoice choice{1U};
+			Send(i, MakeCTOSMsg(CTOSMsg::MsgType::TURN_CHOICE, choice), "TURN_CHOICE", STOCMsg::MsgType::GAME_MSG);
+			break;
+		}
+		case STOCMsg::MsgType::GAME_MSG:
+		{
+			if(body.empty())
+				break;
+			const uint8_t msgType = body[0U];
+			if(YGOPro::CoreUtils::DoesMessageRequireAnswer(msgType))
+			{
+				Think(i, msgType);
+			}
+			else if(msgType == MSG_WIN && i == HOST)
+			{
+				gen.stats.duels++;
+				if(body.size() > 2U && body[2U] == WIN_REASON_WRONG_RESPONSE)
+					gen.stats.diverged++;
+				StartProbe("MSG_WIN", STOCMsg::MsgType::REPLAY);
+			}
+			break;
+		}
+		case STOCMsg::MsgType::REMATCH:
+		{
+			if(i == HOST)
+				Send(i, MakeCTOSMsg(CTOSMsg::MsgType::REMATCH, CTOSMsg::Rematch{0U}));
+			break;
+		}
+		case STOCMsg::MsgType::DUEL_END:
+		{
+			return Finish(false);
+		}
+		case STOCMsg::MsgType::ERROR_MSG:
+		{
+			return Finish(true);
+		}
+		default:
+			break;
+		}
+	}
+
+	// Answers the request after a think time, with the next response of the
+	// replay or by surrendering once there are none left.
+	void Think(std::size_t i, uint8_t msgType)
+	{
+		auto self(shared_from_this());
+		auto& timer = duelists[i].timer;
+		timer.expires_after(ThinkTime());
+		timer.async_wait([this, self, i, msgType](boost::system::error_code ec)
+		{
+			if(ec || finished)
+				return;
+			const auto& responses = replay->Responses();
+			if(nextResponse == responses.size())
+			{
+				Send(i, MakeCTOSMsg(CTOSMsg::MsgType::SURRENDER));
+				return;
+			}
+			const auto& r = responses[nextResponse++];
+			gen.stats.responses++;
+			Send(i, MakeCTOSMsg(CTOSMsg::MsgType::RESPONSE, r.data(), r.size()),
+				RequestName(msgType), STOCMsg::MsgType::GAME_MSG);
+		});
+	}
+
+	Clock::duration ThinkTime()
+	{
+		using namespace std::chrono;
+		const auto median = gen.Opts().thinkTime;
+		if(median.count() == 0)
+			return Clock::duration::zero();
+		std::lognormal_distribution<double> dist(std::log(median.count()), THINK_TIME_SIGMA);
+		return std::min<Clock::duration>(milliseconds(static_cast<int64_t>(dist(rng))), MAX_THINK_TIME);
+	}
+
+	// Closes both connections and opens a room to take this one's place,
+	// after a while if this one failed.
+	void Finish(bool error)
+	{
+		if(finished)
+			return;
+		finished = true;
+		for(auto& d : duelists)
+		{
+			boost::system::error_code ec;
+			d.timer.cancel();
+			d.socket.shutdown(tcp::socket::shutdown_both, ec);
+			d.socket.close(ec);
+		}
+		if(!error)
+		{
+			gen.OpenRoom();
+			return;
+		}
+		gen.stats.errors++;
+		auto timer = std::make_shared<boost::asio::steady_timer>(gen.IoContext(), RETRY_DELAY);
+		timer->async_wait([&gen = gen, timer](boost::system::error_code ec)
+		{
+			if(!ec)
+				gen.OpenRoom();
+		});
+	}
+
+	uint32_t roomId{0U};
+};
+
+void Generator::OpenRoom()
+{
+	if(stopped)
+		return;
+	stats.rooms++;
+	const auto& replays = opts.replays;
+	std::make_shared<Room>(*this, replays[nextReplay++ % replays.size()])->Start();
+}
+
+std::vector<boost::filesystem::path> ListFiles(const boost::filesystem::path& dir, const char* extension)
+{
+	std::vector<boost::filesystem::path> files;
+	for(const auto& de : boost::filesystem::directory_iterator(dir))
+		if(is_regular_file(de.path()) && de.path().extension() == extension)
+			files.emplace_back(de.path());
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+Bytes ReadFile(const boost::filesystem::path& fn)
+{
+	boost::filesystem::ifstream f(fn, std::ios_base::binary);
+	return Bytes(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 6)
+	{
+		std::fprintf(stderr,
+			"Usage: %s <host> <port> <replays dir> <rooms> <seconds> [think time ms] [threads]\n",
+			argv[0]);
+		return 1;
+	}
+	const auto rooms = std::strtoul(argv[4], nullptr, 10);
+	const auto seconds = std::chrono::seconds(std::strtoul(argv[5], nullptr, 10));
+	const auto thinkTime = std::chrono::milliseconds((argc > 6) ? std::strtoul(argv[6], nullptr, 10) : 1000U);
+	const auto threadCount = std::max<std::size_t>((argc > 7) ?
+		std::strtoul(argv[7], nullptr, 10) : std::thread::hardware_concurrency(), 1U);
+	if(rooms == 0U || seconds.count() == 0)
+	{
+		std::fprintf(stderr, "The number of rooms and seconds must be positive.\n");
+		return 1;
+	}
+	boost::asio::io_context ioCtx;
+	Options opts{{}, {}, thinkTime};
+	try
+	{
+		for(const auto& fn : ListFiles(argv[3], ".yrpX"))
+		{
+			try
+			{
+				auto replay = std::make_shared<const YGOPro::ReplayReader>(ReadFile(fn));
+				const auto& duelists = replay->Duelists();
+				if(duelists[0U].size() == 1U && duelists[1U].size() == 1U)
+					opts.replays.emplace_back(std::move(replay));
+			}
+			catch(const std::exception& e)
+			{
+				std::fprintf(stderr, "%s: %s\n", fn.filename().string().data(), e.what());
+			}
+		}
+		if(opts.replays.empty())
+			throw std::runtime_error("No 1v1 replays to play");
+		opts.endpoints = tcp::resolver(ioCtx).resolve(argv[1], argv[2]);
+	}
+	catch(const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return 2;
+	}
+	std::printf("%zu replays, %lu rooms for %lld seconds on %zu threads.\n",
+		opts.replays.size(), rooms, static_cast<long long>(seconds.count()), threadCount);
+	Generator gen(ioCtx, std::move(opts));
+	// Rooms are opened gradually so the server is not hit by every
+	// connection at once.
+	std::vector<std::unique_ptr<boost::asio::steady_timer>> rampUp;
+	for(std::size_t i = 0U; i < rooms; i++)
+	{
+		auto& timer = rampUp.emplace_back(std::make_unique<boost::asio::steady_timer>(ioCtx));
+		timer->expires_after(RAMP_UP * i / rooms);
+		timer->async_wait([&gen](boost::system::error_code ec)
+		{
+			if(!ec)
+				gen.OpenRoom();
+		});
+	}
+	boost::asio::steady_timer deadline(ioCtx, seconds);
+	deadline.async_wait([&gen](boost::system::error_code /*unused*/)
+	{
+		gen.Stop();
+	});
+	std::vector<std::thread> threads;
+	for(std::size_t i = 1U; i < threadCount; i++)
+		threads.emplace_back([&ioCtx]{ioCtx.run();});
+	ioCtx.run();
+	for(auto& t : threads)
+		t.join();
+	gen.stats.Print(seconds);
+	return 0;
+}
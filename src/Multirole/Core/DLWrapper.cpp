@@ -20,13 +20,36 @@ static void DataReader(void* payload, uint32_t code, OCG_CardData* data)
 	*data = static_cast<IDataSupplier*>(payload)->DataFromCode(code);
 }
 
+static bool UseBytecode(Detail::ScriptSupplierData& ssd, OCG_Duel duel)
+{
+	using Detail::BytecodeUse;
+	auto use = ssd.bytecodeUse.load(std::memory_order_relaxed);
+	if(use == BytecodeUse::UNKNOWN)
+	{
+		const auto probe = ssd.supplier.BytecodeProbe();
+		const bool accepted = !probe->empty() &&
+			ssd.OCG_LoadScript(duel, probe->data(), probe->length(), "probe") != 0;
+		use = accepted ? BytecodeUse::YES : BytecodeUse::NO;
+		ssd.bytecodeUse.store(use, std::memory_order_relaxed);
+	}
+	return use == BytecodeUse::YES;
+}
+
 static int ScriptReader(void* payload, OCG_Duel duel, const char* name)
 {
 	auto& ssd = *static_cast<Detail::ScriptSupplierData*>(payload);
-	std::string script = ssd.supplier.ScriptFromFilePath(name);
-	if(script.empty())
+	// NOTE: Once the core accepts bytecode, a failure loading a script is
+	// an error of the script itself and it must not be run again.
+	if(UseBytecode(ssd, duel))
+	{
+		const auto bytecode = ssd.supplier.BytecodeFromFilePath(name);
+		if(!bytecode->empty())
+			return ssd.OCG_LoadScript(duel, bytecode->data(), bytecode->length(), name);
+	}
+	const auto script = ssd.supplier.ScriptFromFilePath(name);
+	if(script->empty())
 		return 0;
-	return ssd.OCG_LoadScript(duel, script.data(), script.length(), name);
+	return ssd.OCG_LoadScript(duel, script->data(), script->length(), name);
 }
 
 static void LogHandler(void* payload, const char* str, int t)
@@ -79,7 +102,7 @@ IWrapper::Duel DLWrapper::CreateDuel(const DuelOptions& opts)
 {
 	OCG_Duel duel{nullptr};
 	std::scoped_lock lock(ssdMutex);
-	auto ssdIter = ssdList.insert(ssdList.end(), {opts.scriptSupplier, OCG_LoadScript});
+	auto ssdIter = ssdList.insert(ssdList.end(), {opts.scriptSupplier, OCG_LoadScript, bytecodeUse});
 	OCG_DuelOptions options =
 	{
 		opts.seed,
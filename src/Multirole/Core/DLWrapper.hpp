@@ -1,5 +1,6 @@
 #ifndef DLWRAPPER_HPP
 #define DLWRAPPER_HPP
+#include <atomic>
 #include <list>
 #include <map>
 #include <mutex>
@@ -11,10 +12,20 @@ namespace Ignis::Multirole::Core
 namespace Detail
 {
 
+// Whether a core is given precompiled scripts, decided the first time it
+// needs a script by loading an empty precompiled chunk.
+enum class BytecodeUse : uint8_t
+{
+	UNKNOWN,
+	YES,
+	NO,
+};
+
 struct ScriptSupplierData
 {
 	IScriptSupplier& supplier;
 	int (*OCG_LoadScript)(OCG_Duel, const char*, uint32_t, const char*);
+	std::atomic<BytecodeUse>& bytecodeUse;
 };
 
 } // namespace Detail
@@ -59,6 +70,7 @@ private:
 	std::list<Detail::ScriptSupplierData> ssdList;
 	std::map<Duel, std::list<Detail::ScriptSupplierData>::iterator> ssdMap;
 	std::mutex ssdMutex;
+	std::atomic<Detail::BytecodeUse> bytecodeUse{Detail::BytecodeUse::UNKNOWN};
 };
 
 } // namespace Ignis::Multirole::Core
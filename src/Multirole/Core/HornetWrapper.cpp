@@ -330,13 +330,32 @@ void HornetWrapper::NotifyAndWait(Hornet::Action act)
 		{
 			const auto* rptr = hss->bytes.data();
 			auto* supplier = static_cast<IScriptSupplier*>(Read<void*>(rptr));
+			const auto kind = Read<Hornet::ScriptKind>(rptr);
 			const auto nameSz = Read<std::size_t>(rptr);
-			const std::string_view nameSv(reinterpret_cast<const char*>(rptr), nameSz);
-			std::string script = supplier->ScriptFromFilePath(nameSv);
+			// NOTE: Hornet sends the name along with its null terminator.
+			const auto* const bytesEnd = hss->bytes.data() + hss->bytes.size();
+			if(nameSz == 0U || nameSz > static_cast<std::size_t>(bytesEnd - rptr))
+			{
+				hanged = true;
+				throw Core::Exception(I18N::HWRAPPER_EXCEPT_MALFORMED_MSG);
+			}
+			const std::string_view nameSv(reinterpret_cast<const char*>(rptr), nameSz - 1U);
+			const auto script = [&]()
+			{
+				switch(kind)
+				{
+				case Hornet::ScriptKind::BYTECODE:
+					return supplier->BytecodeFromFilePath(nameSv);
+				case Hornet::ScriptKind::BYTECODE_PROBE:
+					return supplier->BytecodeProbe();
+				default:
+					return supplier->ScriptFromFilePath(nameSv);
+				}
+			}();
 			auto* wptr = hss->bytes.data();
-			Write<std::size_t>(wptr, script.size());
-			if(!script.empty())
-				std::memcpy(wptr, script.data(), script.size());
+			Write<std::size_t>(wptr, script->size());
+			if(!script->empty())
+				std::memcpy(wptr, script->data(), script->size());
 			act = Hornet::Action::CB_DONE;
 			break;
 		}
@@ -10,7 +10,7 @@ class IDataSupplier
 public:
 	using CardData = OCG_CardData;
 
-	virtual const CardData& DataFromCode(uint32_t code) const = 0;
+	virtual CardData DataFromCode(uint32_t code) const = 0;
 	virtual void DataUsageDone(const CardData& data) const = 0;
 protected:
 	inline ~IDataSupplier() = default;
@@ -1,5 +1,6 @@
 #ifndef ISCRIPTSUPPLIER_HPP
 #define ISCRIPTSUPPLIER_HPP
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -9,7 +10,20 @@ namespace Ignis::Multirole::Core
 class IScriptSupplier
 {
 public:
-	virtual std::string ScriptFromFilePath(std::string_view fp) const noexcept = 0;
+	// Contents of a script, shared by everyone using it and never modified.
+	using Script = std::shared_ptr<const std::string>;
+
+	// Never returns nullptr, scripts that are not found are empty.
+	virtual Script ScriptFromFilePath(std::string_view fp) const noexcept = 0;
+
+	// Same as above but returns the script precompiled to Lua bytecode,
+	// which is empty if there is no such version of the script.
+	virtual Script BytecodeFromFilePath(std::string_view fp) const noexcept = 0;
+
+	// Bytecode of an empty chunk, compiled the same way as the scripts.
+	// Loading it has no effects, so it tells whether a core accepts the
+	// bytecode at all. Empty if scripts are not precompiled.
+	virtual Script BytecodeProbe() const noexcept = 0;
 protected:
 	inline ~IScriptSupplier() noexcept = default;
 };
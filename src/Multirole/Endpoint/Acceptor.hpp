@@ -0,0 +1,104 @@
+#ifndef ENDPOINT_ACCEPTOR_HPP
+#define ENDPOINT_ACCEPTOR_HPP
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "../IoContextPool.hpp"
+#include "../Workaround.hpp"
+
+namespace Ignis::Multirole::Endpoint
+{
+
+#ifdef SO_REUSEPORT
+constexpr bool REUSE_PORT_SUPPORTED = true;
+#else
+constexpr bool REUSE_PORT_SUPPORTED = false;
+#endif // SO_REUSEPORT
+
+using AcceptorHandle = boost::asio::ip::tcp::acceptor::native_handle_type;
+
+struct AcceptorOptions
+{
+	unsigned short port;
+	// If greater than 1, that many acceptors are opened on the same port
+	// with SO_REUSEPORT, spread over the hosting io context pool.
+	unsigned int count;
+	// Listening sockets inherited from a previous instance, if not empty
+	// these are used as-is instead of opening new ones.
+	std::vector<AcceptorHandle> inherited;
+};
+
+// Creates an acceptor listening on the given port for all interfaces, with
+// close-on-exec and keepalive set. If reusePort is true, SO_REUSEPORT is set
+// before binding so several acceptors can listen on the same port at once,
+// letting the kernel distribute incoming connections between them.
+inline boost::asio::ip::tcp::acceptor MakeAcceptor(
+	boost::asio::io_context& ioCtx,
+	unsigned short port,
+	bool reusePort)
+{
+	using namespace boost::asio;
+	const ip::tcp::endpoint endpoint(ip::tcp::v6(), port);
+	ip::tcp::acceptor acceptor(ioCtx, endpoint.protocol());
+	acceptor.set_option(socket_base::reuse_address(true));
+#ifdef SO_REUSEPORT
+	if(reusePort)
+		acceptor.set_option(detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#else
+	(void)reusePort;
+#endif // SO_REUSEPORT
+	acceptor.bind(endpoint);
+	acceptor.listen();
+	Workaround::SetCloseOnExec(acceptor.native_handle());
+	acceptor.set_option(socket_base::keep_alive(true));
+	return acceptor;
+}
+
+// Creates all the acceptors of an endpoint according to the options given.
+// A single acceptor is placed on ioCtx, several acceptors are spread over
+// the io contexts of the pool.
+inline std::vector<boost::asio::ip::tcp::acceptor> MakeAcceptors(
+	boost::asio::io_context& ioCtx,
+	IoContextPool& pool,
+	const AcceptorOptions& opts)
+{
+	using namespace boost::asio;
+	auto IoCtxFor = [&](std::size_t i, std::size_t count) -> io_context&
+	{
+		return (count <= 1U) ? ioCtx : pool.At(i % pool.Size());
+	};
+	std::vector<ip::tcp::acceptor> acceptors;
+	if(const auto count = opts.inherited.size(); count > 0U)
+	{
+		acceptors.reserve(count);
+		for(std::size_t i = 0U; i < count; i++)
+		{
+			const auto handle = opts.inherited[i];
+			Workaround::SetCloseOnExec(handle);
+			acceptors.emplace_back(IoCtxFor(i, count), ip::tcp::v6(), handle);
+		}
+		return acceptors;
+	}
+	const std::size_t count = std::max(opts.count, 1U);
+	acceptors.reserve(count);
+	for(std::size_t i = 0U; i < count; i++)
+		acceptors.emplace_back(MakeAcceptor(IoCtxFor(i, count), opts.port, count > 1U));
+	return acceptors;
+}
+
+// Gets the native handles of the given acceptors.
+inline std::vector<AcceptorHandle> AcceptorHandles(
+	std::vector<boost::asio::ip::tcp::acceptor>& acceptors)
+{
+	std::vector<AcceptorHandle> handles;
+	handles.reserve(acceptors.size());
+	for(auto& acceptor : acceptors)
+		handles.push_back(acceptor.native_handle());
+	return handles;
+}
+
+} // namespace Ignis::Multirole::Endpoint
+
+#endif // ENDPOINT_ACCEPTOR_HPP
@@ -1,5 +1,6 @@
 #include "LobbyListing.hpp"
 
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/json.hpp>
 #include <fmt/format.h> // fmt::to_string
@@ -61,17 +62,17 @@ private:
 
 LobbyListing::LobbyListing(
 	boost::asio::io_context& ioCtx,
-	unsigned short port,
+	IoContextPool& pool,
+	const AcceptorOptions& opts,
 	Lobby& lobby)
 	:
-	acceptor(ioCtx, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port)),
+	acceptors(MakeAcceptors(ioCtx, pool, opts)),
 	serializeTimer(ioCtx),
 	lobby(lobby),
 	serialized(std::make_shared<std::string>())
 {
-	Workaround::SetCloseOnExec(acceptor.native_handle());
-	acceptor.set_option(boost::asio::socket_base::keep_alive(true));
-	DoAccept();
+	for(auto& acceptor : acceptors)
+		DoAccept(acceptor);
 	DoSerialize();
 }
 
@@ -79,10 +80,16 @@ LobbyListing::~LobbyListing() = default;
 
 void LobbyListing::Stop()
 {
-	acceptor.close();
+	for(auto& acceptor : acceptors)
+		boost::asio::dispatch(acceptor.get_executor(), [&acceptor]{acceptor.close();});
 	serializeTimer.cancel();
 }
 
+std::vector<AcceptorHandle> LobbyListing::NativeHandles()
+{
+	return AcceptorHandles(acceptors);
+}
+
 // private
 
 void LobbyListing::DoSerialize()
@@ -144,10 +151,10 @@ void LobbyListing::DoSerialize()
 	});
 }
 
-void LobbyListing::DoAccept()
+void LobbyListing::DoAccept(boost::asio::ip::tcp::acceptor& acceptor)
 {
 	acceptor.async_accept(
-	[this](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket)
+	[this, &acceptor](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket)
 	{
 		if(!acceptor.is_open())
 			return;
@@ -157,7 +164,7 @@ void LobbyListing::DoAccept()
 			std::scoped_lock lock(mSerialized);
 			std::make_shared<Connection>(std::move(socket), serialized)->DoRead();
 		}
-		DoAccept();
+		DoAccept(acceptor);
 	});
 }
 
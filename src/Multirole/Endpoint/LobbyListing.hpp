@@ -2,10 +2,13 @@
 #define LOBBYLISTING_HPP
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include "Acceptor.hpp"
+
 namespace Ignis::Multirole
 {
 
@@ -17,20 +20,23 @@ namespace Endpoint
 class LobbyListing final
 {
 public:
-	LobbyListing(boost::asio::io_context& ioCtx, unsigned short port, Lobby& lobby);
+	LobbyListing(boost::asio::io_context& ioCtx, IoContextPool& pool, const AcceptorOptions& opts, Lobby& lobby);
 	~LobbyListing();
 
 	void Stop();
+
+	// Native handles of the listening sockets, used for handoffs.
+	std::vector<AcceptorHandle> NativeHandles();
 private:
 	class Connection;
 
-	boost::asio::ip::tcp::acceptor acceptor;
+	std::vector<boost::asio::ip::tcp::acceptor> acceptors;
 	boost::asio::steady_timer serializeTimer;
 	Lobby& lobby;
 	std::shared_ptr<const std::string> serialized;
 	std::mutex mSerialized;
 
-	void DoAccept();
+	void DoAccept(boost::asio::ip::tcp::acceptor& acceptor);
 	void DoSerialize();
 };
 
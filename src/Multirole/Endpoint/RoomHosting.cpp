@@ -1,13 +1,17 @@
 #include "RoomHosting.hpp"
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/read.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/write.hpp>
 
 #include "../I18N.hpp"
+#include "../IoContextPool.hpp"
 #include "../Lobby.hpp"
 #include "../STOCMsgFactory.hpp"
 #include "../Workaround.hpp"
-#include "../Room/Client.hpp"
 #include "../Room/Instance.hpp"
 #include "../Service/BanlistProvider.hpp"
 #include "../YGOPro/Config.hpp"
@@ -67,26 +71,43 @@ inline std::string Utf16BufferToStr(const Buffer& buffer)
 	return UTF16ToUTF8(BufferToUTF16(buffer, sizeof(Buffer)));
 }
 
-class RoomHosting::Connection final : public std::enable_shared_from_this<Connection>
+class RoomHosting::Connection final : public std::enable_shared_from_this<Connection>, public TimerWheel::IEntry
 {
 public:
 	Connection(const RoomHosting& roomHosting,
+		boost::asio::io_context& ioCtx,
 		boost::asio::ip::tcp::socket socket) noexcept
 		:
 		roomHosting(roomHosting),
+		ioCtx(ioCtx),
+		strand(ioCtx.get_executor()),
 		socket(std::move(socket))
 	{}
 
+	// Closes the socket if the connection is still alive once the handshake
+	// deadline is reached, be it waiting for a message or for the peer to
+	// close after an error. Successful connections are moved to a room
+	// before that, so they are no longer referenced by then.
+	void OnTimeout() noexcept override
+	{
+		auto self(shared_from_this());
+		boost::asio::post(strand, [this, self]()
+		{
+			boost::system::error_code ignore;
+			socket.close(ignore);
+		});
+	}
+
 	void DoReadHeader() noexcept
 	{
 		auto self(shared_from_this());
 		auto buffer = boost::asio::buffer(incoming.Data(), YGOPro::CTOSMsg::HEADER_LENGTH);
-		boost::asio::async_read(socket, buffer,
+		boost::asio::async_read(socket, buffer, boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(!ec && incoming.IsHeaderValid())
 				DoReadBody();
-		});
+		}));
 	}
 private:
 	enum class Status
@@ -97,6 +118,8 @@ private:
 	};
 
 	const RoomHosting& roomHosting;
+	boost::asio::io_context& ioCtx; // Io context where socket was created.
+	boost::asio::strand<boost::asio::io_context::executor_type> strand;
 	boost::asio::ip::tcp::socket socket;
 	std::string ip;
 	std::string name;
@@ -107,7 +130,7 @@ private:
 	{
 		auto self(shared_from_this());
 		auto buffer = boost::asio::buffer(incoming.Body(), incoming.GetLength());
-		boost::asio::async_read(socket, buffer,
+		boost::asio::async_read(socket, buffer, boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(ec)
@@ -121,7 +144,7 @@ private:
 				DoReadEnd();
 				DoWrite();
 			}
-		});
+		}));
 	}
 
 	void DoWrite() noexcept
@@ -130,6 +153,7 @@ private:
 		auto self(shared_from_this());
 		const auto& front = outgoing.front();
 		boost::asio::async_write(socket, boost::asio::buffer(front.Data(), front.Length()),
+		boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(ec)
@@ -139,19 +163,19 @@ private:
 				DoWrite();
 			else
 				socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
-		});
+		}));
 	}
 
 	void DoReadEnd() noexcept
 	{
 		auto self(shared_from_this());
 		auto buffer = boost::asio::buffer(incoming.Data(), YGOPro::CTOSMsg::MSG_MAX_LENGTH);
-		socket.async_read_some(buffer,
+		socket.async_read_some(buffer, boost::asio::bind_executor(strand,
 		[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 		{
 			if(!ec)
 				DoReadEnd();
-		});
+		}));
 	}
 
 	Status HandleMsg() noexcept
@@ -203,7 +227,7 @@ private:
 			// All the info required to construct a working room is set here.
 			Room::Instance::CreateInfo info
 			{
-				roomHosting.ioCtx,
+				ioCtx,
 				std::string(p->notes),
 				Utf16BufferToStr(p->pass),
 				roomHosting.svc,
@@ -252,7 +276,8 @@ private:
 				std::move(room),
 				std::move(socket),
 				std::move(ip),
-				std::move(name))->Start();
+				std::move(name),
+				roomHosting.idleTimeouts)->Start();
 			return Status::STATUS_MOVED;
 		}
 		case YGOPro::CTOSMsg::MsgType::JOIN_GAME:
@@ -281,12 +306,17 @@ private:
 				PushToWriteQueue(PrebuiltMsgId::PREBUILT_GENERIC_JOIN_ERROR);
 				return Status::STATUS_ERROR;
 			}
+			// Move the socket to the io context of the room if it lives
+			// on a different one, so the room is handled by a single thread.
+			if(auto& roomIoCtx = room->Strand().context(); &roomIoCtx != &ioCtx)
+				Rehome(roomIoCtx);
 			std::make_shared<Room::Client>(
 				roomHosting.lobby,
 				std::move(room),
 				std::move(socket),
 				std::move(ip),
-				std::move(name))->Start();
+				std::move(name),
+				roomHosting.idleTimeouts)->Start();
 			return Status::STATUS_MOVED;
 		}
 		default:
@@ -297,6 +327,24 @@ private:
 		}
 		}
 	}
+
+	// Moves the socket onto another io context, if that is not possible
+	// for some reason then the socket is kept on the current one.
+	void Rehome(boost::asio::io_context& other) noexcept
+	{
+		boost::system::error_code ec;
+		const auto protocol = socket.local_endpoint(ec).protocol();
+		if(ec)
+			return;
+		const auto fd = socket.release(ec);
+		if(ec)
+			return;
+		boost::asio::ip::tcp::socket rehomed(other);
+		if(rehomed.assign(protocol, fd, ec); !ec)
+			socket = std::move(rehomed);
+		else
+			socket.assign(protocol, fd, ec);
+	}
 };
 
 inline YGOPro::STOCMsg SrvMsg(const char* const str)
@@ -306,7 +354,13 @@ inline YGOPro::STOCMsg SrvMsg(const char* const str)
 
 // public
 
-RoomHosting::RoomHosting(boost::asio::io_context& ioCtx, Service& svc, Lobby& lobby, unsigned short port)
+RoomHosting::RoomHosting(
+	boost::asio::io_context& ioCtx,
+	IoContextPool& pool,
+	Service& svc,
+	Lobby& lobby,
+	const AcceptorOptions& opts,
+	const Timeouts& timeouts)
 	:
 	prebuiltMsgs({
 		STOCMsgFactory::MakeVersionError(YGOPro::SERVER_VERSION),
@@ -319,36 +373,53 @@ RoomHosting::RoomHosting(boost::asio::io_context& ioCtx, Service& svc, Lobby& lo
 		SrvMsg(I18N::CLIENT_ROOM_HOSTING_CANNOT_RESOLVE_IP),
 		SrvMsg(I18N::CLIENT_ROOM_HOSTING_MAX_CONNECTION_REACHED),
 	}),
-	ioCtx(ioCtx),
+	pool(pool),
 	svc(svc),
 	lobby(lobby),
-	acceptor(ioCtx, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port))
+	wheel(ioCtx),
+	handshakeTimeout(timeouts.handshake),
+	idleTimeouts({wheel, timeouts.waitingIdle, timeouts.duelingIdle}),
+	acceptors(MakeAcceptors(ioCtx, pool, opts))
 {
-	Workaround::SetCloseOnExec(acceptor.native_handle());
-	acceptor.set_option(boost::asio::socket_base::keep_alive(true));
-	DoAccept();
+	for(auto& acceptor : acceptors)
+		DoAccept(acceptor);
 }
 
 void RoomHosting::Stop()
 {
-	acceptor.close();
+	for(auto& acceptor : acceptors)
+		boost::asio::dispatch(acceptor.get_executor(), [&acceptor]{acceptor.close();});
+	wheel.Stop();
+}
+
+std::vector<AcceptorHandle> RoomHosting::NativeHandles()
+{
+	return AcceptorHandles(acceptors);
 }
 
 // private
 
-void RoomHosting::DoAccept()
+void RoomHosting::DoAccept(boost::asio::ip::tcp::acceptor& acceptor)
 {
-	acceptor.async_accept(
-	[this](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket)
+	// NOTE: When there are several acceptors, each one hands connections to
+	// the io context it runs on, otherwise connections are spread.
+	auto& ioCtx = (acceptors.size() > 1U) ?
+		static_cast<boost::asio::io_context&>(acceptor.get_executor().context()) :
+		pool.Next();
+	acceptor.async_accept(ioCtx,
+	[this, &acceptor, &ioCtx](const boost::system::error_code& ec, boost::asio::ip::tcp::socket socket)
 	{
 		if(!acceptor.is_open())
 			return;
 		if(!ec)
 		{
 			Workaround::SetCloseOnExec(socket.native_handle());
-			std::make_shared<Connection>(*this, std::move(socket))->DoReadHeader();
+			auto c = std::make_shared<Connection>(*this, ioCtx, std::move(socket));
+			if(handshakeTimeout != 0U)
+				wheel.Schedule(c, handshakeTimeout);
+			c->DoReadHeader();
 		}
-		DoAccept();
+		DoAccept(acceptor);
 	});
 }
 
@@ -3,11 +3,15 @@
 #include <mutex>
 #include <memory>
 #include <set>
+#include <vector>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "Acceptor.hpp"
 #include "../Service.hpp"
+#include "../TimerWheel.hpp"
+#include "../Room/Client.hpp"
 #include "../YGOPro/STOCMsg.hpp"
 
 namespace Ignis::Multirole
@@ -21,8 +25,21 @@ namespace Endpoint
 class RoomHosting final
 {
 public:
-	RoomHosting(boost::asio::io_context& ioCtx, Service& svc, Lobby& lobby, unsigned short port);
+	// Number of seconds each phase of a connection can last without
+	// activity, 0 disables the respective check.
+	struct Timeouts
+	{
+		// Time to join or create a room since the connection was accepted.
+		unsigned int handshake;
+		unsigned int waitingIdle;
+		unsigned int duelingIdle;
+	};
+
+	RoomHosting(boost::asio::io_context& ioCtx, IoContextPool& pool, Service& svc, Lobby& lobby, const AcceptorOptions& opts, const Timeouts& timeouts);
 	void Stop();
+
+	// Native handles of the listening sockets, used for handoffs.
+	std::vector<AcceptorHandle> NativeHandles();
 private:
 	enum class PrebuiltMsgId
 	{
@@ -45,12 +62,15 @@ private:
 		YGOPro::STOCMsg,
 		static_cast<std::size_t>(PrebuiltMsgId::PREBUILT_MSG_COUNT)
 	> prebuiltMsgs;
-	boost::asio::io_context& ioCtx;
+	IoContextPool& pool;
 	Service& svc;
 	Lobby& lobby;
-	boost::asio::ip::tcp::acceptor acceptor;
+	TimerWheel wheel;
+	const unsigned int handshakeTimeout;
+	const Room::Client::IdleTimeouts idleTimeouts;
+	std::vector<boost::asio::ip::tcp::acceptor> acceptors;
 
-	void DoAccept();
+	void DoAccept(boost::asio::ip::tcp::acceptor& acceptor);
 };
 
 } // namespace Endpoint
@@ -76,8 +76,14 @@ private:
 
 // public
 
-Webhook::Webhook(boost::asio::io_context& ioCtx, unsigned short port) :
-	acceptor(ioCtx, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port))
+Webhook::Webhook(
+	boost::asio::io_context& ioCtx,
+	unsigned short port,
+	std::optional<AcceptorHandle> inherited)
+	:
+	acceptor(inherited ?
+		boost::asio::ip::tcp::acceptor(ioCtx, boost::asio::ip::tcp::v6(), *inherited) :
+		boost::asio::ip::tcp::acceptor(ioCtx, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port)))
 {
 	Workaround::SetCloseOnExec(acceptor.native_handle());
 	acceptor.set_option(boost::asio::socket_base::keep_alive(true));
@@ -89,6 +95,11 @@ void Webhook::Stop()
 	acceptor.close();
 }
 
+AcceptorHandle Webhook::NativeHandle() noexcept
+{
+	return acceptor.native_handle();
+}
+
 void Webhook::Callback([[maybe_unused]] std::string_view payload)
 {}
 
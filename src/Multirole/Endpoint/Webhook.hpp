@@ -1,17 +1,28 @@
 #ifndef WEBHOOKENDPOINT_HPP
 #define WEBHOOKENDPOINT_HPP
+#include <optional>
+
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "Acceptor.hpp"
+
 namespace Ignis::Multirole::Endpoint
 {
 
 class Webhook
 {
 public:
-	Webhook(boost::asio::io_context& ioCtx, unsigned short port);
+	// If given, the inherited listening socket is used as-is instead of
+	// binding the port again.
+	Webhook(
+		boost::asio::io_context& ioCtx,
+		unsigned short port,
+		std::optional<AcceptorHandle> inherited);
 	void Stop();
 
+	AcceptorHandle NativeHandle() noexcept;
+
 	virtual void Callback(std::string_view payload);
 protected:
 	inline ~Webhook() = default;
@@ -1,5 +1,6 @@
 #include "GitRepo.hpp"
 
+#include <boost/asio/post.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/json/value.hpp>
 
@@ -28,13 +29,23 @@ int CredCb(git_cred** out, const char* /*unused*/, const char* /*unused*/, unsig
 
 // public
 
-GitRepo::GitRepo(Service::LogHandler& lh, boost::asio::io_context& ioCtx, const boost::json::value& opts) :
-	Webhook(ioCtx, opts.at("webhookPort").to_number<unsigned short>()),
+GitRepo::GitRepo(
+	Service::LogHandler& lh,
+	boost::asio::io_context& ioCtx,
+	boost::asio::io_context& updateIoCtx,
+	const boost::json::value& opts,
+	std::optional<Endpoint::AcceptorHandle> inheritedWebhook,
+	bool deferSync)
+	:
+	Webhook(ioCtx, opts.at("webhookPort").to_number<unsigned short>(), inheritedWebhook),
 	lh(lh),
+	updateIoCtx(updateIoCtx),
 	token(opts.at("webhookToken").as_string().data()),
 	remote(opts.at("remote").as_string().data()),
 	path(opts.at("path").as_string().data()),
-	repo(nullptr)
+	repo(nullptr),
+	head(),
+	updatePending(false)
 {
 	if(const auto* const cred = opts.as_object().if_contains("credentials"); cred)
 	{
@@ -48,10 +59,17 @@ GitRepo::GitRepo(Service::LogHandler& lh, boost::asio::io_context& ioCtx, const
 	{
 		LOG_INFO(I18N::GIT_REPO_DOES_NOT_EXIST);
 		Clone();
+		LoadHead();
 		return;
 	}
 	LOG_INFO(I18N::GIT_REPO_EXISTS);
 	Git::Check(git_repository_open(&repo, path.string().data()));
+	if(deferSync)
+	{
+		LOG_INFO(I18N::GIT_REPO_DEFERRING_UPDATES);
+		LoadHead();
+		return;
+	}
 	LOG_INFO(I18N::GIT_REPO_CHECKING_UPDATES);
 	try
 	{
@@ -74,20 +92,31 @@ GitRepo::~GitRepo()
 void GitRepo::AddObserver(IGitRepoObserver& obs)
 {
 	observers.emplace_back(&obs);
-	if(const PathVector pv = GetTrackedFiles(); !pv.empty())
-		obs.OnAdd(path, pv);
 }
 
-// private
+const boost::filesystem::path& GitRepo::Path() const noexcept
+{
+	return path;
+}
 
-void GitRepo::Callback(std::string_view payload)
+PathVector GitRepo::TrackedFiles() const
 {
-	LOG_INFO(I18N::GIT_REPO_WEBHOOK_TRIGGERED, path.string());
-	if(payload.find(token) == std::string_view::npos)
+	// git ls-files
+	PathVector pv;
+	auto index = Git::MakeUnique(git_repository_index, repo);
+	const std::size_t entryCount = git_index_entrycount(index.get());
+	const git_index_entry* entry = nullptr;
+	for(std::size_t i = 0; i < entryCount; i++)
 	{
-		LOG_ERROR(I18N::GIT_REPO_WEBHOOK_NO_TOKEN);
-		return;
+		entry = git_index_get_byindex(index.get(), i);
+		pv.emplace_back(entry->path);
 	}
+	return pv;
+}
+
+void GitRepo::Update() noexcept
+{
+	updatePending = false;
 	try
 	{
 		Fetch();
@@ -104,6 +133,22 @@ void GitRepo::Callback(std::string_view payload)
 	}
 }
 
+// private
+
+void GitRepo::Callback(std::string_view payload)
+{
+	LOG_INFO(I18N::GIT_REPO_WEBHOOK_TRIGGERED, path.string());
+	if(payload.find(token) == std::string_view::npos)
+	{
+		LOG_ERROR(I18N::GIT_REPO_WEBHOOK_NO_TOKEN);
+		return;
+	}
+	// Webhooks received while an update is queued are folded into it.
+	if(updatePending.exchange(true))
+		return;
+	boost::asio::post(updateIoCtx, [this](){Update();});
+}
+
 bool GitRepo::CheckIfRepoExists() const
 {
 	return git_repository_open_ext(
@@ -147,11 +192,19 @@ void GitRepo::ResetToFetchHead()
 	auto commit = Git::MakeUnique(git_commit_lookup, repo, &oid);
 	Git::Check(git_reset(repo, reinterpret_cast<git_object*>(commit.get()),
 	                     GIT_RESET_HARD, nullptr));
+	head = oid;
+}
+
+void GitRepo::LoadHead() noexcept
+{
+	// NOTE: If HEAD is unborn, diffs are made against an empty tree.
+	if(git_reference_name_to_id(&head, repo, "HEAD") != 0)
+		head = git_oid{};
 }
 
 GitDiff GitRepo::GetFilesDiff() const
 {
-	// git diff ..FETCH_HEAD
+	// git diff <head>..FETCH_HEAD
 	auto FileCb = [](const git_diff_delta* delta, float /*unused*/, void* payload) -> int
 	{
 		auto& diff = *static_cast<GitDiff*>(payload);
@@ -170,9 +223,10 @@ GitDiff GitRepo::GetFilesDiff() const
 		}
 		return 0;
 	};
-	auto obj1 = Git::MakeUnique(git_revparse_single, repo, "HEAD");
+	auto t1 = (git_oid_iszero(&head) == 1) ?
+		Git::UniqueObj<git_tree>(nullptr, Git::Detail::DtorType_v<git_tree>) :
+		Git::Peel<git_tree>(Git::MakeUnique(git_object_lookup, repo, &head, GIT_OBJ_ANY));
 	auto obj2 = Git::MakeUnique(git_revparse_single, repo, "FETCH_HEAD");
-	auto t1 = Git::Peel<git_tree>(std::move(obj1));
 	auto t2 = Git::Peel<git_tree>(std::move(obj2));
 	auto obj3 = Git::MakeUnique(git_diff_tree_to_tree, repo, t1.get(), t2.get(), nullptr);
 	GitDiff diff;
@@ -180,19 +234,4 @@ GitDiff GitRepo::GetFilesDiff() const
 	return diff;
 }
 
-PathVector GitRepo::GetTrackedFiles() const
-{
-	// git ls-files
-	PathVector pv;
-	auto index = Git::MakeUnique(git_repository_index, repo);
-	const std::size_t entryCount = git_index_entrycount(index.get());
-	const git_index_entry* entry = nullptr;
-	for(std::size_t i = 0; i < entryCount; i++)
-	{
-		entry = git_index_get_byindex(index.get(), i);
-		pv.emplace_back(entry->path);
-	}
-	return pv;
-}
-
 } // namespace Ignis::Multirole
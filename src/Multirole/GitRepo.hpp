@@ -1,9 +1,12 @@
 #ifndef GITREPO_HPP
 #define GITREPO_HPP
+#include <atomic>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include <boost/json/fwd.hpp>
+#include <git2/oid.h>
 
 #include "IGitRepoObserver.hpp"
 #include "Service.hpp"
@@ -19,7 +22,21 @@ class GitRepo final : public Endpoint::Webhook
 public:
 	using Credentials = std::pair<std::string, std::string>;
 
-	GitRepo(Service::LogHandler& lh, boost::asio::io_context& ioCtx, const boost::json::value& opts);
+	// Webhooks are received on ioCtx while updates (fetching as well as
+	// notifying the observers) are done on updateIoCtx, so that slow
+	// updates don't hold up other webhooks nor anything else on ioCtx.
+	// NOTE: Observers are only notified from updateIoCtx after construction,
+	// thus a single thread running it serializes all updates.
+	// If deferSync is true the repository is only opened (or cloned if it
+	// does not exist yet) and it is not brought up to date until Update is
+	// called, as it might still be in use by a previous instance.
+	GitRepo(
+		Service::LogHandler& lh,
+		boost::asio::io_context& ioCtx,
+		boost::asio::io_context& updateIoCtx,
+		const boost::json::value& opts,
+		std::optional<Endpoint::AcceptorHandle> inheritedWebhook,
+		bool deferSync);
 	~GitRepo();
 
 	// Remove copy and move operations.
@@ -28,15 +45,28 @@ public:
 	GitRepo& operator=(const GitRepo&) = delete;
 	GitRepo& operator=(GitRepo&&) = delete;
 
+	// Observers are notified of the updates made after adding them, the
+	// files already tracked are not passed to them (see TrackedFiles).
 	void AddObserver(IGitRepoObserver& obs);
+
+	const boost::filesystem::path& Path() const noexcept;
+	PathVector TrackedFiles() const;
+
+	// Fetches and resets to the remote's head, notifying the observers of
+	// the files changed since the commit checked out by the last update
+	// (or construction). Must be called from updateIoCtx.
+	void Update() noexcept;
 private:
 	Service::LogHandler& lh;
+	boost::asio::io_context& updateIoCtx;
 	const std::string token;
 	const std::string remote;
 	const boost::filesystem::path path;
 	std::unique_ptr<Credentials> credPtr;
 	git_repository* repo;
+	git_oid head; // Commit whose files the observers know about.
 	std::vector<IGitRepoObserver*> observers;
+	std::atomic<bool> updatePending;
 
 	// Endpoint::Webhook override
 	void Callback(std::string_view payload) override;
@@ -46,8 +76,10 @@ private:
 	void Fetch();
 	void ResetToFetchHead();
 
+	// Remembers the commit currently checked out.
+	void LoadHead() noexcept;
+
 	GitDiff GetFilesDiff() const;
-	std::vector<boost::filesystem::path> GetTrackedFiles() const;
 };
 
 } // namespace Ignis::Multirole
@@ -0,0 +1,324 @@
+#include "Handoff.hpp"
+
+#include <array>
+#include <cstring> // std::memcpy
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/json/value.hpp>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h> // close
+#endif // _WIN32
+
+#include "I18N.hpp"
+#include "Workaround.hpp"
+#include "Service/LogHandler.hpp"
+#define LOG_INFO(...) lh.Log(ServiceType::MULTIROLE, Level::INFO, __VA_ARGS__)
+#define LOG_WARN(...) lh.Log(ServiceType::MULTIROLE, Level::WARN, __VA_ARGS__)
+#define LOG_ERROR(...) lh.Log(ServiceType::MULTIROLE, Level::ERROR, __VA_ARGS__)
+
+namespace Ignis::Multirole
+{
+
+namespace
+{
+
+constexpr uint32_t HANDOFF_MAGIC = 0x4D524846;
+constexpr int HANDOFF_TIMEOUT_IN_SECONDS = 10;
+constexpr int HANDOFF_RELEASE_TIMEOUT_IN_SECONDS = 60;
+
+struct Header
+{
+	uint32_t magic;
+	uint32_t lobbyListingCount;
+	uint32_t roomHostingCount;
+	uint32_t webhookCount;
+};
+
+#ifndef _WIN32
+// Sends a single byte along with a file descriptor.
+void SendHandle(int fd, Endpoint::AcceptorHandle handle)
+{
+	char byte = 0;
+	iovec iov{&byte, 1U};
+	std::array<char, CMSG_SPACE(sizeof(int))> control{};
+	msghdr msg{};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1U;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	std::memcpy(CMSG_DATA(cmsg), &handle, sizeof(int));
+	if(sendmsg(fd, &msg, MSG_NOSIGNAL) != 1)
+		throw std::runtime_error(I18N::HANDOFF_ERROR_SENDING_HANDLE);
+}
+
+// Receives a single byte along with a file descriptor.
+Endpoint::AcceptorHandle ReceiveHandle(int fd)
+{
+	char byte = 0;
+	iovec iov{&byte, 1U};
+	std::array<char, CMSG_SPACE(sizeof(int))> control{};
+	msghdr msg{};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1U;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+	int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+	flags |= MSG_CMSG_CLOEXEC;
+#endif // MSG_CMSG_CLOEXEC
+	if(recvmsg(fd, &msg, flags) != 1)
+		throw std::runtime_error(I18N::HANDOFF_ERROR_RECEIVING_HANDLE);
+	const cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if(cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+	   cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+		throw std::runtime_error(I18N::HANDOFF_ERROR_RECEIVING_HANDLE);
+	int handle = -1;
+	std::memcpy(&handle, CMSG_DATA(cmsg), sizeof(int));
+	Workaround::SetCloseOnExec(handle);
+	return handle;
+}
+
+// Port a listening socket is bound to.
+unsigned short LocalPort(Endpoint::AcceptorHandle handle)
+{
+	sockaddr_storage addr{};
+	socklen_t len = sizeof(addr);
+	if(getsockname(handle, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+		throw std::runtime_error(I18N::HANDOFF_ERROR_RECEIVING_HANDLE);
+	if(addr.ss_family == AF_INET6)
+		return ntohs(reinterpret_cast<const sockaddr_in6&>(addr).sin6_port);
+	return ntohs(reinterpret_cast<const sockaddr_in&>(addr).sin_port);
+}
+#endif // _WIN32
+
+} // namespace
+
+// public
+
+Handoff::Handoff(Service::LogHandler& lh, boost::asio::io_context& ioCtx, const boost::json::value& opts) :
+	lh(lh),
+	enabled(opts.at("enabled").as_bool()),
+	path(opts.at("path").as_string().data()),
+	acceptor(ioCtx)
+{
+	if(!enabled)
+		return;
+#ifdef _WIN32
+	throw std::runtime_error(I18N::HANDOFF_NOT_SUPPORTED);
+#else
+	TakeOver(ioCtx);
+#endif // _WIN32
+}
+
+Handoff::~Handoff() = default;
+
+bool Handoff::HasPrevious() const noexcept
+{
+	return previous.has_value();
+}
+
+const Handoff::Handles& Handoff::InheritedLobbyListing() const noexcept
+{
+	return inheritedLobbyListing;
+}
+
+const Handoff::Handles& Handoff::InheritedRoomHosting() const noexcept
+{
+	return inheritedRoomHosting;
+}
+
+std::optional<Endpoint::AcceptorHandle> Handoff::TakeInheritedWebhook(unsigned short port) noexcept
+{
+	auto search = inheritedWebhooks.find(port);
+	if(search == inheritedWebhooks.end())
+		return std::nullopt;
+	const auto handle = search->second;
+	inheritedWebhooks.erase(search);
+	return handle;
+}
+
+void Handoff::Listen(
+	Handles lobbyListing,
+	Handles roomHosting,
+	Handles webhooks,
+	std::function<void()> onHandedOff)
+{
+	if(!enabled)
+		return;
+	this->lobbyListing = std::move(lobbyListing);
+	this->roomHosting = std::move(roomHosting);
+	this->webhooks = std::move(webhooks);
+	this->onHandedOff = std::move(onHandedOff);
+	// NOTE: If there was a previous instance, its listening socket is still
+	// open but it becomes unreachable once the path is unlinked.
+	boost::system::error_code ec;
+	boost::filesystem::remove(path, ec);
+	const Protocol::endpoint endpoint(path);
+	acceptor.open(endpoint.protocol());
+	acceptor.bind(endpoint);
+	acceptor.listen();
+	Workaround::SetCloseOnExec(acceptor.native_handle());
+	LOG_INFO(I18N::HANDOFF_LISTENING, path);
+	DoAccept();
+}
+
+void Handoff::NotifyReady() noexcept
+{
+#ifndef _WIN32
+	for(const auto& kv : inheritedWebhooks)
+		close(kv.second);
+	inheritedWebhooks.clear();
+#endif // _WIN32
+	if(!previous)
+		return;
+	const char byte = 0;
+	boost::system::error_code ec;
+	previous->write_some(boost::asio::buffer(&byte, 1U), ec);
+	if(ec)
+		LOG_ERROR(I18N::HANDOFF_ERROR_NOTIFYING_READY, ec.message());
+}
+
+void Handoff::WaitForRelease() noexcept
+{
+#ifndef _WIN32
+	if(!previous)
+		return;
+	LOG_INFO(I18N::HANDOFF_WAITING_RELEASE);
+	const int fd = previous->native_handle();
+	const timeval tv{HANDOFF_RELEASE_TIMEOUT_IN_SECONDS, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	// NOTE: Nothing else is sent, the connection is just closed.
+	char byte = 0;
+	ssize_t r = 0;
+	do
+	{
+		r = recv(fd, &byte, 1U, 0);
+	}
+	while(r < 0 && errno == EINTR);
+	if(r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		LOG_WARN(I18N::HANDOFF_RELEASE_TIMEOUT);
+	previous.reset();
+#endif // _WIN32
+}
+
+void Handoff::Release() noexcept
+{
+	successor.reset();
+}
+
+void Handoff::Stop() noexcept
+{
+	boost::system::error_code ignore;
+	acceptor.close(ignore);
+}
+
+// private
+
+void Handoff::TakeOver([[maybe_unused]] boost::asio::io_context& ioCtx)
+{
+#ifndef _WIN32
+	Protocol::socket socket(ioCtx);
+	if(boost::system::error_code ec; socket.connect(Protocol::endpoint(path), ec))
+	{
+		LOG_INFO(I18N::HANDOFF_NO_PREVIOUS_INSTANCE);
+		return;
+	}
+	const int fd = socket.native_handle();
+	Workaround::SetCloseOnExec(fd);
+	// Avoid waiting indefinitely for a misbehaving previous instance.
+	const timeval tv{HANDOFF_TIMEOUT_IN_SECONDS, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	// NOTE: Not using asio for synchronous reads as it would poll the socket
+	// instead of honoring the timeout.
+	Header header{};
+	if(recv(fd, &header, sizeof(header), MSG_WAITALL) != sizeof(header) ||
+	   header.magic != HANDOFF_MAGIC)
+		throw std::runtime_error(I18N::HANDOFF_WRONG_MAGIC);
+	for(uint32_t i = 0U; i < header.lobbyListingCount; i++)
+		inheritedLobbyListing.push_back(ReceiveHandle(fd));
+	for(uint32_t i = 0U; i < header.roomHostingCount; i++)
+		inheritedRoomHosting.push_back(ReceiveHandle(fd));
+	for(uint32_t i = 0U; i < header.webhookCount; i++)
+	{
+		const auto handle = ReceiveHandle(fd);
+		inheritedWebhooks.emplace(LocalPort(handle), handle);
+	}
+	previous.emplace(std::move(socket));
+	LOG_INFO(I18N::HANDOFF_TOOK_OVER,
+		inheritedLobbyListing.size() + inheritedRoomHosting.size() + inheritedWebhooks.size());
+#endif // _WIN32
+}
+
+void Handoff::DoAccept()
+{
+	acceptor.async_accept(
+	[this](const boost::system::error_code& ec, Protocol::socket socket)
+	{
+		if(!acceptor.is_open())
+			return;
+		if(ec)
+		{
+			DoAccept();
+			return;
+		}
+		LOG_INFO(I18N::HANDOFF_SUCCESSOR_CONNECTED);
+#ifndef _WIN32
+		try
+		{
+			const Header header
+			{
+				HANDOFF_MAGIC,
+				static_cast<uint32_t>(lobbyListing.size()),
+				static_cast<uint32_t>(roomHosting.size()),
+				static_cast<uint32_t>(webhooks.size())
+			};
+			boost::asio::write(socket, boost::asio::buffer(&header, sizeof(header)));
+			for(const auto handle : lobbyListing)
+				SendHandle(socket.native_handle(), handle);
+			for(const auto handle : roomHosting)
+				SendHandle(socket.native_handle(), handle);
+			for(const auto handle : webhooks)
+				SendHandle(socket.native_handle(), handle);
+		}
+		catch(const std::exception& e)
+		{
+			LOG_ERROR(I18N::HANDOFF_ERROR_SENDING, e.what());
+			DoAccept();
+			return;
+		}
+#endif // _WIN32
+		// Wait until the successor is ready, if it fails to start up then
+		// the connection is closed and we keep running as usual.
+		auto s = std::make_shared<Protocol::socket>(std::move(socket));
+		auto buffer = std::make_shared<char>();
+		boost::asio::async_read(*s, boost::asio::buffer(buffer.get(), 1U),
+		[this, s, buffer](const boost::system::error_code& ec, std::size_t /*unused*/)
+		{
+			if(!acceptor.is_open())
+				return;
+			if(ec)
+			{
+				LOG_WARN(I18N::HANDOFF_SUCCESSOR_FAILED);
+				DoAccept();
+				return;
+			}
+			LOG_INFO(I18N::HANDOFF_SUCCESSOR_READY);
+			// NOTE: Kept open until the repositories are closed.
+			successor = s;
+			onHandedOff();
+		});
+	});
+}
+
+} // namespace Ignis::Multirole
@@ -0,0 +1,101 @@
+#ifndef HANDOFF_HPP
+#define HANDOFF_HPP
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/json/fwd.hpp>
+
+#include "Service.hpp"
+#include "Endpoint/Acceptor.hpp"
+
+namespace Ignis::Multirole
+{
+
+// Passes the listening sockets of a running instance to a newly launched
+// one through a Unix domain socket, so the new instance can start accepting
+// connections without re-binding ports while the old one finishes its
+// remaining duels.
+//
+// Protocol (from the point of view of the new instance):
+//	1. Connect to the socket path and receive a header with the number of
+//	   lobby listing, room hosting and webhook sockets, followed by one
+//	   message per socket carrying its file descriptor (SCM_RIGHTS).
+//	2. Once ready to run, write a single byte. The old instance then stops
+//	   the same way as if it received SIGTERM.
+//	3. Wait for the old instance to close the connection, which it does once
+//	   it is done with the repositories, before updating them.
+// Replay IDs need no handoff, as they are already synchronized between
+// processes by ReplayManager's file lock.
+class Handoff final
+{
+public:
+	using Handles = std::vector<Endpoint::AcceptorHandle>;
+
+	// If enabled, tries to take over the listening sockets from a previous
+	// instance listening on the configured path.
+	Handoff(Service::LogHandler& lh, boost::asio::io_context& ioCtx, const boost::json::value& opts);
+	~Handoff();
+
+	// Tells if the listening sockets were taken over from a previous
+	// instance, which might still be using the repositories.
+	bool HasPrevious() const noexcept;
+
+	// Listening sockets received from the previous instance, if any.
+	const Handles& InheritedLobbyListing() const noexcept;
+	const Handles& InheritedRoomHosting() const noexcept;
+
+	// Takes the webhook listening socket received from the previous
+	// instance for the given port, if any.
+	std::optional<Endpoint::AcceptorHandle> TakeInheritedWebhook(unsigned short port) noexcept;
+
+	// If enabled, starts listening for a successor. The given listening
+	// sockets are passed to it and onHandedOff is called once it is ready.
+	void Listen(
+		Handles lobbyListing,
+		Handles roomHosting,
+		Handles webhooks,
+		std::function<void()> onHandedOff);
+
+	// Tells the previous instance (if any) that this one is about to start
+	// accepting connections, so it can close its acceptors. Webhook sockets
+	// that were not taken are closed.
+	void NotifyReady() noexcept;
+
+	// Blocks until the previous instance (if any) is done with the
+	// repositories, or until a timeout.
+	void WaitForRelease() noexcept;
+
+	// Tells the successor (if any) that this instance is done with the
+	// repositories, must be called after closing them.
+	void Release() noexcept;
+
+	void Stop() noexcept;
+private:
+	using Protocol = boost::asio::local::stream_protocol;
+
+	Service::LogHandler& lh;
+	const bool enabled;
+	const std::string path;
+	Handles inheritedLobbyListing;
+	Handles inheritedRoomHosting;
+	std::map<unsigned short, Endpoint::AcceptorHandle> inheritedWebhooks;
+	std::optional<Protocol::socket> previous;
+	Protocol::acceptor acceptor;
+	Handles lobbyListing;
+	Handles roomHosting;
+	Handles webhooks;
+	std::function<void()> onHandedOff;
+	std::shared_ptr<Protocol::socket> successor;
+
+	void TakeOver(boost::asio::io_context& ioCtx);
+	void DoAccept();
+};
+
+} // namespace Ignis::Multirole
+
+#endif // HANDOFF_HPP
@@ -7,6 +7,7 @@ Str GIT_REPO_PATH_IS_NOT_DIR = "Repository path is not a directory.";
 Str GIT_REPO_DOES_NOT_EXIST = "Repository does not exist, cloning...";
 Str GIT_REPO_EXISTS = "Repository exists! Opening...";
 Str GIT_REPO_CHECKING_UPDATES = "Checking for updates...";
+Str GIT_REPO_DEFERRING_UPDATES = "Previous instance might still be using it, updating later.";
 Str GIT_REPO_UPDATE_COMPLETED = "Update completed!";
 Str GIT_REPO_WEBHOOK_TRIGGERED = "Webhook triggered.";
 Str GIT_REPO_WEBHOOK_NO_TOKEN = "Webhook payload does not have a token.";
@@ -19,6 +20,7 @@ Str MULTIROLE_ADDING_REPO = "Adding repository '{0}'...";
 Str MULTIROLE_SETUP_SIGNAL = "Setting up signal handling...";
 Str MULTIROLE_SIGNAL_RECEIVED = "SIGTERM received.";
 Str MULTIROLE_HOSTING_THREADS_NUM = "Hosting will use {0} threads.";
+Str MULTIROLE_IO_CONTEXT_PER_THREAD = "Each hosting thread will have its own io context.";
 Str MULTIROLE_INIT_SUCCESS = "Initialization finished successfully!";
 Str MULTIROLE_GOODBYE = "Good bye!";
 Str MULTIROLE_CLEANING_UP = "Closing acceptors and repositories...";
@@ -26,6 +28,21 @@ Str MULTIROLE_REMAINING_ROOMS = "Rooms that were not closed: {0}";
 
 Str MAIN_SERVER_INIT_FAILURE = "Could not initialize server: {0}\n";
 
+Str HANDOFF_NOT_SUPPORTED = "Handoff: Not supported on this platform.";
+Str HANDOFF_NO_PREVIOUS_INSTANCE = "No previous instance to take over from.";
+Str HANDOFF_WRONG_MAGIC = "Handoff: Unexpected data received from previous instance.";
+Str HANDOFF_ERROR_RECEIVING_HANDLE = "Handoff: Unable to receive listening socket.";
+Str HANDOFF_TOOK_OVER = "Took over {0} listening sockets from previous instance.";
+Str HANDOFF_ERROR_NOTIFYING_READY = "Unable to notify previous instance: {0}";
+Str HANDOFF_WAITING_RELEASE = "Waiting for previous instance to release repositories...";
+Str HANDOFF_RELEASE_TIMEOUT = "Previous instance did not release repositories in time, updating them anyway.";
+Str HANDOFF_LISTENING = "Listening for a successor on '{0}'.";
+Str HANDOFF_SUCCESSOR_CONNECTED = "Successor connected, handing listening sockets over...";
+Str HANDOFF_ERROR_SENDING_HANDLE = "Unable to send listening socket.";
+Str HANDOFF_ERROR_SENDING = "Error while handing listening sockets over: {0}";
+Str HANDOFF_SUCCESSOR_FAILED = "Successor disconnected before becoming ready.";
+Str HANDOFF_SUCCESSOR_READY = "Successor is ready, stopping.";
+
 Str DLWRAPPER_EXCEPT_CREATE_DUEL = "OCG_CreateDuel failed!";
 
 Str HWRAPPER_UNABLE_TO_LAUNCH = "Unable to launch child.";
@@ -34,6 +51,7 @@ Str HWRAPPER_EXCEPT_CREATE_DUEL = DLWRAPPER_EXCEPT_CREATE_DUEL;
 Str HWRAPPER_EXCEPT_MAX_LOOP_COUNT = "Max loop count reached.";
 Str HWRAPPER_EXCEPT_PROC_CRASHED = "Process is not running.";
 Str HWRAPPER_EXCEPT_PROC_UNRESPONSIVE = "Process is unresponsive.";
+Str HWRAPPER_EXCEPT_MALFORMED_MSG = "Process sent a malformed message.";
 
 Str CLIENT_ROOM_HOSTING_INVALID_NAME = "Invalid name. Try filling in your name!";
 Str CLIENT_ROOM_HOSTING_NOT_FOUND = "Room not found. Try refreshing the list!";
@@ -67,6 +85,7 @@ Str CLIENT_ROOM_KICKED = "{0} has been kicked.";
 
 Str BANLIST_PROVIDER_LOADING_ONE = "Loading up {0}...";
 Str BANLIST_PROVIDER_COULD_NOT_LOAD_ONE = "Could not load banlist: {0}";
+Str BANLIST_PROVIDER_COULD_NOT_COMPILE = "Could not compile banlists: {0}";
 
 Str CORE_PROVIDER_COULD_NOT_CREATE_TMP_DIR = "CoreProvider: Could not create temporary directory.";
 Str CORE_PROVIDER_PATH_IS_FILE_NOT_DIR = "CoreProvider: Temporary directory path points to a file.";
@@ -79,6 +98,8 @@ Str CORE_PROVIDER_ERROR_WHILE_TESTING = "Error while testing core '{0}': {1}";
 
 Str DATA_PROVIDER_LOADING_ONE = BANLIST_PROVIDER_LOADING_ONE;
 Str DATA_PROVIDER_COULD_NOT_MERGE = "Could not merge database.";
+Str DATA_PROVIDER_LOADED_IMAGE = "Loaded {1} cards from image {0}.";
+Str DATA_PROVIDER_COULD_NOT_SAVE_IMAGE = "Could not save database image to {0}.";
 
 Str ROOM_LOGGER_ROOM_NOTES = "Room Notes = \"{0}\"";
 Str ROOM_LOGGER_ROOM_HOST = "Room Host = {0}({1})";
@@ -108,9 +129,12 @@ Str REPLAY_MANAGER_LASTID_SIZE_CORRUPTED =
 Str REPLAY_MANAGER_UNABLE_TO_SAVE = "Unable to save replay {0}.";
 Str REPLAY_MANAGER_CANNOT_OPEN_LASTID = "lastId cannot be opened for reading.";
 Str REPLAY_MANAGER_CANNOT_WRITE_ID = "Unable to write next replay ID to file.";
+Str REPLAY_MANAGER_QUEUE_FULL = "Replay write queue is full, writing replay {0} right away.";
 
 Str SCRIPT_PROVIDER_LOADING_FILES = "Loading {0} files...";
 Str SCRIPT_PROVIDER_COULD_NOT_OPEN = "Could not open file {0}.";
 Str SCRIPT_PROVIDER_TOTAL_FILES_LOADED = "Loaded {0} files.";
+Str SCRIPT_PROVIDER_COULD_NOT_COMPILE = "Could not compile {0}: {1}";
+Str SCRIPT_PROVIDER_NO_BYTECODE_SUPPORT = "Script precompilation requested but Lua support was not built in.";
 
 } // namespace Ignis::Multirole::I18N
@@ -12,6 +12,7 @@ extern Str GIT_REPO_PATH_IS_NOT_DIR;
 extern Str GIT_REPO_DOES_NOT_EXIST;
 extern Str GIT_REPO_EXISTS;
 extern Str GIT_REPO_CHECKING_UPDATES;
+extern Str GIT_REPO_DEFERRING_UPDATES;
 extern Str GIT_REPO_UPDATE_COMPLETED;
 extern Str GIT_REPO_WEBHOOK_TRIGGERED;
 extern Str GIT_REPO_WEBHOOK_NO_TOKEN;
@@ -24,6 +25,7 @@ extern Str MULTIROLE_ADDING_REPO;
 extern Str MULTIROLE_SETUP_SIGNAL;
 extern Str MULTIROLE_SIGNAL_RECEIVED;
 extern Str MULTIROLE_HOSTING_THREADS_NUM;
+extern Str MULTIROLE_IO_CONTEXT_PER_THREAD;
 extern Str MULTIROLE_INIT_SUCCESS;
 extern Str MULTIROLE_GOODBYE;
 extern Str MULTIROLE_CLEANING_UP;
@@ -31,6 +33,21 @@ extern Str MULTIROLE_REMAINING_ROOMS;
 
 extern Str MAIN_SERVER_INIT_FAILURE;
 
+extern Str HANDOFF_NOT_SUPPORTED;
+extern Str HANDOFF_NO_PREVIOUS_INSTANCE;
+extern Str HANDOFF_WRONG_MAGIC;
+extern Str HANDOFF_ERROR_RECEIVING_HANDLE;
+extern Str HANDOFF_TOOK_OVER;
+extern Str HANDOFF_ERROR_NOTIFYING_READY;
+extern Str HANDOFF_WAITING_RELEASE;
+extern Str HANDOFF_RELEASE_TIMEOUT;
+extern Str HANDOFF_LISTENING;
+extern Str HANDOFF_SUCCESSOR_CONNECTED;
+extern Str HANDOFF_ERROR_SENDING_HANDLE;
+extern Str HANDOFF_ERROR_SENDING;
+extern Str HANDOFF_SUCCESSOR_FAILED;
+extern Str HANDOFF_SUCCESSOR_READY;
+
 extern Str DLWRAPPER_EXCEPT_CREATE_DUEL;
 
 // NOTE: HWRAPPER == HORNET_WRAPPER
@@ -40,6 +57,7 @@ extern Str HWRAPPER_EXCEPT_CREATE_DUEL;
 extern Str HWRAPPER_EXCEPT_MAX_LOOP_COUNT;
 extern Str HWRAPPER_EXCEPT_PROC_CRASHED;
 extern Str HWRAPPER_EXCEPT_PROC_UNRESPONSIVE;
+extern Str HWRAPPER_EXCEPT_MALFORMED_MSG;
 
 extern Str CLIENT_ROOM_HOSTING_INVALID_NAME;
 extern Str CLIENT_ROOM_HOSTING_NOT_FOUND;
@@ -66,6 +84,7 @@ extern Str CLIENT_ROOM_KICKED;
 
 extern Str BANLIST_PROVIDER_LOADING_ONE;
 extern Str BANLIST_PROVIDER_COULD_NOT_LOAD_ONE;
+extern Str BANLIST_PROVIDER_COULD_NOT_COMPILE;
 
 extern Str CORE_PROVIDER_COULD_NOT_CREATE_TMP_DIR;
 extern Str CORE_PROVIDER_PATH_IS_FILE_NOT_DIR;
@@ -78,6 +97,8 @@ extern Str CORE_PROVIDER_ERROR_WHILE_TESTING;
 
 extern Str DATA_PROVIDER_LOADING_ONE;
 extern Str DATA_PROVIDER_COULD_NOT_MERGE;
+extern Str DATA_PROVIDER_LOADED_IMAGE;
+extern Str DATA_PROVIDER_COULD_NOT_SAVE_IMAGE;
 
 extern Str ROOM_LOGGER_ROOM_NOTES;
 extern Str ROOM_LOGGER_ROOM_HOST;
@@ -107,10 +128,13 @@ extern Str REPLAY_MANAGER_LASTID_SIZE_CORRUPTED;
 extern Str REPLAY_MANAGER_UNABLE_TO_SAVE;
 extern Str REPLAY_MANAGER_CANNOT_OPEN_LASTID;
 extern Str REPLAY_MANAGER_CANNOT_WRITE_ID;
+extern Str REPLAY_MANAGER_QUEUE_FULL;
 
 extern Str SCRIPT_PROVIDER_LOADING_FILES;
 extern Str SCRIPT_PROVIDER_COULD_NOT_OPEN;
 extern Str SCRIPT_PROVIDER_TOTAL_FILES_LOADED;
+extern Str SCRIPT_PROVIDER_COULD_NOT_COMPILE;
+extern Str SCRIPT_PROVIDER_NO_BYTECODE_SUPPORT;
 
 } // namespace Ignis::Multirole::I18N
 
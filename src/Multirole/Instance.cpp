@@ -1,13 +1,17 @@
 #include "Instance.hpp"
 
+#include <array>
 #include <csignal>
 #include <cstdlib> // Exit flags
+#include <future>
 #include <thread>
 
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/json/value.hpp>
 
+#include "Endpoint/Acceptor.hpp"
 #define LOG_INFO(...) logHandler.Log(ServiceType::MULTIROLE, Level::INFO, __VA_ARGS__)
 #include "I18N.hpp"
 
@@ -24,6 +28,13 @@ constexpr unsigned int GetConcurrency(int hint) noexcept
 	return static_cast<unsigned int>(hint);
 }
 
+constexpr unsigned int GetAcceptorCount(bool reusePort, unsigned int concurrency) noexcept
+{
+	if(!reusePort || !Endpoint::REUSE_PORT_SUPPORTED)
+		return 1U;
+	return concurrency;
+}
+
 inline Service::CoreProvider::CoreType GetCoreType(std::string_view str)
 {
 	auto ret = Service::CoreProvider::CoreType::SHARED;
@@ -34,6 +45,17 @@ inline Service::CoreProvider::CoreType GetCoreType(std::string_view str)
 	return ret;
 }
 
+inline YGOPro::Replay::Compression GetReplayCompression(const boost::json::value& opts)
+{
+	return
+	{
+		opts.at("level").to_number<int>(),
+		opts.at("dictSize").to_number<uint32_t>(),
+		opts.at("fastModeThreshold").to_number<std::size_t>(),
+		opts.at("multiThreadThreshold").to_number<std::size_t>()
+	};
+}
+
 } // namespace
 
 // public
@@ -42,55 +64,138 @@ Instance::Instance(const boost::json::value& cfg) :
 	auxIoCtx(),
 	lIoCtx(),
 	lIoCtxGuard(boost::asio::make_work_guard(lIoCtx)),
+	uIoCtx(),
+	uIoCtxGuard(boost::asio::make_work_guard(uIoCtx)),
 	hostingConcurrency(GetConcurrency(cfg.at("concurrencyHint").to_number<int>())),
+	hostingPool(lIoCtx, hostingConcurrency, cfg.at("ioContextPerThread").as_bool()),
 	logHandler(auxIoCtx, cfg.at("logHandler").as_object()),
-	banlistProvider(logHandler, cfg.at("banlistProvider").at("fileRegex").as_string()),
+	banlistProvider(
+		logHandler,
+		dataProvider,
+		cfg.at("banlistProvider").at("fileRegex").as_string()),
 	coreProvider(
 		logHandler,
 		cfg.at("coreProvider").at("fileRegex").as_string(),
 		cfg.at("coreProvider").at("tmpPath").as_string().data(),
 		GetCoreType(cfg.at("coreProvider").at("coreType").as_string()),
 		cfg.at("coreProvider").at("loadPerRoom").as_bool()),
-	dataProvider(logHandler, cfg.at("dataProvider").at("fileRegex").as_string()),
+	dataProvider(
+		logHandler,
+		cfg.at("dataProvider").at("fileRegex").as_string(),
+		cfg.at("dataProvider").at("imagePath").as_string()),
+	deckCache(cfg.at("deckCache").at("capacity").to_number<std::size_t>()),
 	replayManager(
 		logHandler,
 		cfg.at("replayManager").at("save").as_bool(),
-		cfg.at("replayManager").at("path").as_string().data()),
-	scriptProvider(logHandler, cfg.at("scriptProvider").at("fileRegex").as_string()),
-	service({banlistProvider, coreProvider, dataProvider, logHandler,
-		replayManager, scriptProvider}),
+		cfg.at("replayManager").at("path").as_string().data(),
+		cfg.at("replayManager").at("idLeaseSize").to_number<uint64_t>(),
+		cfg.at("replayManager").at("maxQueuedBytes").to_number<std::size_t>(),
+		cfg.at("replayManager").at("segmentSize").to_number<uint64_t>(),
+		std::chrono::seconds(cfg.at("replayManager").at("segmentLifetime").to_number<unsigned int>()),
+		GetReplayCompression(cfg.at("replayManager").at("sendCompression")),
+		GetReplayCompression(cfg.at("replayManager").at("saveCompression"))),
+	scriptProvider(
+		logHandler,
+		cfg.at("scriptProvider").at("fileRegex").as_string(),
+		cfg.at("scriptProvider").at("precompile").as_bool()),
+	service({banlistProvider, coreProvider, dataProvider, deckCache,
+		logHandler, replayManager, scriptProvider}),
 	lobby(cfg.at("lobbyMaxConnections").to_number<int>()),
+	handoff(logHandler, lIoCtx, cfg.at("handoff")),
 	lobbyListing(
 		lIoCtx,
-		cfg.at("lobbyListingPort").to_number<unsigned short>(),
+		hostingPool,
+		{
+			cfg.at("lobbyListingPort").to_number<unsigned short>(),
+			GetAcceptorCount(cfg.at("reusePortAcceptors").as_bool(), hostingConcurrency),
+			handoff.InheritedLobbyListing()
+		},
 		lobby),
 	roomHosting(
 		lIoCtx,
+		hostingPool,
 		service,
 		lobby,
-		cfg.at("roomHostingPort").to_number<unsigned short>()),
+		{
+			cfg.at("roomHostingPort").to_number<unsigned short>(),
+			GetAcceptorCount(cfg.at("reusePortAcceptors").as_bool(), hostingConcurrency),
+			handoff.InheritedRoomHosting()
+		},
+		{
+			cfg.at("roomHostingTimeouts").at("handshake").to_number<unsigned int>(),
+			cfg.at("roomHostingTimeouts").at("waitingIdle").to_number<unsigned int>(),
+			cfg.at("roomHostingTimeouts").at("duelingIdle").to_number<unsigned int>()
+		}),
 	signalSet(lIoCtx)
 {
 	// Load up and update repositories while also adding them to the std::map
-	for(const auto& opts : cfg.at("repos").as_array())
+	// NOTE: Each repository is cloned or fetched on its own thread. If there
+	// is a previous instance, its webhook sockets are taken over and the
+	// repositories are only updated once it is done with them (see Run).
 	{
-		auto name = opts.at("name").as_string().data();
-		LOG_INFO(I18N::MULTIROLE_ADDING_REPO, name);
-		repos.emplace(
-			std::piecewise_construct,
-			std::forward_as_tuple(name),
-			std::forward_as_tuple(logHandler, auxIoCtx, opts));
+		const bool deferSync = handoff.HasPrevious();
+		std::vector<std::pair<std::string, std::future<std::unique_ptr<GitRepo>>>> pending;
+		for(const auto& opts : cfg.at("repos").as_array())
+		{
+			std::string name = opts.at("name").as_string().data();
+			LOG_INFO(I18N::MULTIROLE_ADDING_REPO, name);
+			const auto webhook = handoff.TakeInheritedWebhook(
+				opts.at("webhookPort").to_number<unsigned short>());
+			pending.emplace_back(std::move(name), std::async(std::launch::async,
+			[this, o = &opts, webhook, deferSync]()
+			{
+				return std::make_unique<GitRepo>(logHandler, auxIoCtx, uIoCtx, *o, webhook, deferSync);
+			}));
+		}
+		for(auto& p : pending)
+			repos.emplace(p.first, p.second.get());
 	}
-	// Register respective providers on their observed repositories
+	// Register respective providers on their observed repositories, the
+	// returned function loads the files the repositories already have.
 	auto RegRepos = [&](IGitRepoObserver& obs, const boost::json::value& v)
 	{
+		std::vector<std::pair<boost::filesystem::path, PathVector>> tracked;
 		for(const auto& observed : v.at("observedRepos").as_array())
-			repos.at(observed.as_string().data()).AddObserver(obs);
+		{
+			auto& repo = *repos.at(observed.as_string().data());
+			repo.AddObserver(obs);
+			if(PathVector pv = repo.TrackedFiles(); !pv.empty())
+				tracked.emplace_back(repo.Path(), std::move(pv));
+		}
+		return [&obs, tracked = std::move(tracked)]()
+		{
+			for(const auto& [path, pv] : tracked)
+				obs.OnAdd(path, pv);
+		};
 	};
-	RegRepos(dataProvider, cfg.at("dataProvider"));
-	RegRepos(scriptProvider, cfg.at("scriptProvider"));
-	RegRepos(banlistProvider, cfg.at("banlistProvider"));
-	RegRepos(coreProvider, cfg.at("coreProvider"));
+	// Banlists are compiled against each card database as soon as it is
+	// loaded, rather than by the first room to use them.
+	dataProvider.SetReloadHandler([this](std::shared_ptr<YGOPro::CardDatabase> db)
+	{
+		banlistProvider.OnDatabaseReload(std::move(db));
+	});
+	auto loadData = RegRepos(dataProvider, cfg.at("dataProvider"));
+	auto loadScripts = RegRepos(scriptProvider, cfg.at("scriptProvider"));
+	auto loadBanlists = RegRepos(banlistProvider, cfg.at("banlistProvider"));
+	auto loadCore = RegRepos(coreProvider, cfg.at("coreProvider"));
+	// Load each provider on its own thread. Card databases of all observed
+	// repositories are loaded together, once they were all added, and
+	// banlists after them so they are compiled against them right away.
+	{
+		std::array<std::future<void>, 3U> loading
+		{
+			std::async(std::launch::async, [&]()
+			{
+				loadData();
+				dataProvider.LoadDatabases();
+				loadBanlists();
+			}),
+			std::async(std::launch::async, loadScripts),
+			std::async(std::launch::async, loadCore)
+		};
+		for(auto& l : loading)
+			l.get();
+	}
 	// Register signal
 	LOG_INFO(I18N::MULTIROLE_SETUP_SIGNAL);
 	signalSet.add(SIGTERM);
@@ -99,17 +204,63 @@ Instance::Instance(const boost::json::value& cfg) :
 		LOG_INFO(I18N::MULTIROLE_SIGNAL_RECEIVED);
 		Stop();
 	});
+	// Let a future instance take over our listening sockets
+	{
+		Handoff::Handles webhooks;
+		for(auto& kv : repos)
+			webhooks.push_back(kv.second->NativeHandle());
+		handoff.Listen(lobbyListing.NativeHandles(), roomHosting.NativeHandles(),
+			std::move(webhooks),
+		[this]()
+		{
+			Stop();
+		});
+	}
 	LOG_INFO(I18N::MULTIROLE_HOSTING_THREADS_NUM, hostingConcurrency);
+	if(hostingPool.IsPerThread())
+		LOG_INFO(I18N::MULTIROLE_IO_CONTEXT_PER_THREAD);
 	LOG_INFO(I18N::MULTIROLE_INIT_SUCCESS);
 }
 
 int Instance::Run() noexcept
 {
-	std::thread webhooks([&]{auxIoCtx.run();});
-	boost::asio::thread_pool threads(hostingConcurrency);
-	for(unsigned int i = 0U; i < hostingConcurrency; i++)
+	handoff.NotifyReady();
+	// NOTE: Repositories shared with a previous instance are brought up to
+	// date once it is done with them. Updates requested through webhooks
+	// meanwhile are queued after this one, so they wait as well.
+	if(handoff.HasPrevious())
+	{
+		boost::asio::post(uIoCtx, [&]
+		{
+			handoff.WaitForRelease();
+			for(auto& kv : repos)
+				kv.second->Update();
+		});
+	}
+	std::thread webhooks([&]
+	{
+		auxIoCtx.run();
+		// NOTE: Repositories are closed (so other process can acquire locks)
+		// from the updates thread, once it is done with the pending updates,
+		// and only after webhooks can no longer queue new ones. A successor
+		// waits for this before updating them itself.
+		boost::asio::post(uIoCtx, [&]
+		{
+			repos.clear();
+			handoff.Release();
+		});
+		uIoCtxGuard.reset();
+	});
+	std::thread updates([&]{uIoCtx.run();});
+	// NOTE: If each hosting thread has its own io context then an additional
+	// thread is needed to run the lobby's io context.
+	const bool perThread = hostingPool.IsPerThread();
+	boost::asio::thread_pool threads(hostingConcurrency + static_cast<unsigned int>(perThread));
+	if(perThread)
 		boost::asio::dispatch(threads, [&]{lIoCtx.run();});
+	hostingPool.Run(threads);
 	webhooks.join();
+	updates.join();
 	threads.join();
 	LOG_INFO(I18N::MULTIROLE_GOODBYE);
 	return EXIT_SUCCESS;
@@ -122,7 +273,9 @@ void Instance::Stop() noexcept
 	LOG_INFO(I18N::MULTIROLE_CLEANING_UP);
 	auxIoCtx.stop(); // Finishes execution of thread created in Instance::Run
 	lIoCtxGuard.reset(); // Allows hosting threads to finish execution
-	repos.clear(); // Closes repositories (so other process can acquire locks)
+	hostingPool.Stop();
+	signalSet.cancel(); // In case we were stopped by a handoff
+	handoff.Stop();
 	lobbyListing.Stop();
 	roomHosting.Stop();
 	if(const std::size_t remainingRooms = lobby.Close(); remainingRooms > 0U)
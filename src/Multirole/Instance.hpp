@@ -1,12 +1,15 @@
 #ifndef SERVERINSTANCE_HPP
 #define SERVERINSTANCE_HPP
 #include <map>
+#include <memory>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/json/fwd.hpp>
 
 #include "GitRepo.hpp"
+#include "Handoff.hpp"
+#include "IoContextPool.hpp"
 #include "Lobby.hpp"
 #include "Service.hpp"
 #include "Endpoint/LobbyListing.hpp"
@@ -14,6 +17,7 @@
 #include "Service/BanlistProvider.hpp"
 #include "Service/CoreProvider.hpp"
 #include "Service/DataProvider.hpp"
+#include "Service/DeckCache.hpp"
 #include "Service/LogHandler.hpp"
 #include "Service/ReplayManager.hpp"
 #include "Service/ScriptProvider.hpp"
@@ -30,19 +34,24 @@ private:
 	boost::asio::io_context auxIoCtx; // Auxiliary Io Context
 	boost::asio::io_context lIoCtx; // Lobby Io Context
 	boost::asio::executor_work_guard<boost::asio::io_context::executor_type> lIoCtxGuard;
+	boost::asio::io_context uIoCtx; // Repositories' Updates Io Context
+	boost::asio::executor_work_guard<boost::asio::io_context::executor_type> uIoCtxGuard;
 	unsigned int hostingConcurrency;
+	IoContextPool hostingPool;
 	Service::LogHandler logHandler;
 	Service::BanlistProvider banlistProvider;
 	Service::CoreProvider coreProvider;
 	Service::DataProvider dataProvider;
+	Service::DeckCache deckCache;
 	Service::ReplayManager replayManager;
 	Service::ScriptProvider scriptProvider;
 	Service service;
 	Lobby lobby;
+	Handoff handoff;
 	Endpoint::LobbyListing lobbyListing;
 	Endpoint::RoomHosting roomHosting;
 	boost::asio::signal_set signalSet;
-	std::map<std::string, GitRepo> repos;
+	std::map<std::string, std::unique_ptr<GitRepo>> repos;
 
 	void Stop() noexcept;
 };
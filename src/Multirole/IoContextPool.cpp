@@ -0,0 +1,67 @@
+#include "IoContextPool.hpp"
+
+#include <cassert>
+
+#include <boost/asio/dispatch.hpp>
+
+namespace Ignis::Multirole
+{
+
+IoContextPool::IoContextPool(boost::asio::io_context& shared, unsigned int concurrency, bool perThread) :
+	concurrency(concurrency),
+	next(0U)
+{
+	if(!perThread)
+	{
+		ioCtxs.emplace_back(&shared);
+		return;
+	}
+	for(unsigned int i = 0U; i < concurrency; i++)
+	{
+		// NOTE: Only one thread will run each of these.
+		auto& ioCtx = *ownIoCtxs.emplace_back(std::make_unique<boost::asio::io_context>(1));
+		guards.emplace_back(boost::asio::make_work_guard(ioCtx));
+		ioCtxs.emplace_back(&ioCtx);
+	}
+}
+
+std::size_t IoContextPool::Size() const noexcept
+{
+	return ioCtxs.size();
+}
+
+bool IoContextPool::IsPerThread() const noexcept
+{
+	return !ownIoCtxs.empty();
+}
+
+boost::asio::io_context& IoContextPool::At(std::size_t i) const noexcept
+{
+	assert(i < ioCtxs.size());
+	return *ioCtxs[i];
+}
+
+boost::asio::io_context& IoContextPool::Next() noexcept
+{
+	return *ioCtxs[next.fetch_add(1U, std::memory_order_relaxed) % ioCtxs.size()];
+}
+
+void IoContextPool::Run(boost::asio::thread_pool& threads) noexcept
+{
+	if(ownIoCtxs.empty())
+	{
+		for(unsigned int i = 0U; i < concurrency; i++)
+			boost::asio::dispatch(threads, [ioCtx = ioCtxs.front()]{ioCtx->run();});
+		return;
+	}
+	for(auto& ioCtx : ownIoCtxs)
+		boost::asio::dispatch(threads, [ioCtx = ioCtx.get()]{ioCtx->run();});
+}
+
+void IoContextPool::Stop() noexcept
+{
+	for(auto& guard : guards)
+		guard.reset();
+}
+
+} // namespace Ignis::Multirole
@@ -0,0 +1,55 @@
+#ifndef IOCONTEXTPOOL_HPP
+#define IOCONTEXTPOOL_HPP
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+namespace Ignis::Multirole
+{
+
+// Set of io contexts used for room hosting. Depending on the options passed
+// on construction, the pool either consists of a single io context that is
+// run by every hosting thread, or one io context per hosting thread, in
+// which case every handler of a given room is run by the same thread.
+class IoContextPool final
+{
+public:
+	IoContextPool(boost::asio::io_context& shared, unsigned int concurrency, bool perThread);
+
+	// Number of io contexts in the pool.
+	std::size_t Size() const noexcept;
+
+	// Whether or not each hosting thread runs its own io context.
+	bool IsPerThread() const noexcept;
+
+	// Get a particular io context of the pool.
+	boost::asio::io_context& At(std::size_t i) const noexcept;
+
+	// Get the io contexts in a round-robin fashion, used to pick the
+	// io context that will handle a new connection (and its room).
+	boost::asio::io_context& Next() noexcept;
+
+	// Posts the execution of the io contexts onto the thread pool, it is
+	// expected for the thread pool to have `concurrency` threads available.
+	void Run(boost::asio::thread_pool& threads) noexcept;
+
+	// Allows the io contexts owned by the pool to finish execution once they
+	// run out of work.
+	void Stop() noexcept;
+private:
+	using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+	const unsigned int concurrency;
+	std::vector<std::unique_ptr<boost::asio::io_context>> ownIoCtxs;
+	std::vector<WorkGuard> guards;
+	std::vector<boost::asio::io_context*> ioCtxs;
+	std::atomic<std::size_t> next;
+};
+
+} // namespace Ignis::Multirole
+
+#endif // IOCONTEXTPOOL_HPP
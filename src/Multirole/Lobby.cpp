@@ -8,6 +8,8 @@ namespace Ignis::Multirole
 namespace
 {
 
+constexpr auto ID_QUARANTINE_PERIOD = std::chrono::minutes(1);
+
 inline std::chrono::time_point<std::chrono::system_clock>::rep TimeNowInt()
 {
 	return std::chrono::system_clock::now().time_since_epoch().count();
@@ -20,7 +22,8 @@ inline std::chrono::time_point<std::chrono::system_clock>::rep TimeNowInt()
 Lobby::Lobby(int maxConnections) :
 	maxConnections(maxConnections),
 	rng(static_cast<std::mt19937::result_type>(TimeNowInt())),
-	closed(false)
+	closed(false),
+	nextId(1U)
 {}
 
 std::shared_ptr<Room::Instance> Lobby::GetRoomById(uint32_t id) const
@@ -57,17 +60,14 @@ std::size_t Lobby::Close()
 std::shared_ptr<Room::Instance> Lobby::MakeRoom(Room::Instance::CreateInfo& info)
 {
 	std::scoped_lock lock(mRooms);
-	for(uint32_t newId = 1U; true; newId++)
-	{
-		if(rooms.count(newId) == 0U)
-		{
-			info.id = newId;
-			break;
-		}
-	}
+	info.id = AllocateId();
 	info.seed = rng();
 	auto room = std::make_shared<Room::Instance>(info);
-	if(!closed)
+	// NOTE: Rooms made after closing are not tracked, so CollectRooms would
+	// never give their id back.
+	if(closed)
+		ReleaseId(info.id);
+	else
 		rooms.emplace(info.id, room);
 	return room;
 }
@@ -91,6 +91,7 @@ void Lobby::CollectRooms(const std::function<void(const RoomProps&)>& f)
 			++it;
 			continue;
 		}
+		ReleaseId(it->first);
 		it = rooms.erase(it);
 	}
 }
@@ -115,4 +116,23 @@ void Lobby::DecrementConnectionCount(const std::string& ip)
 		connections.erase(search);
 }
 
+// private
+
+uint32_t Lobby::AllocateId()
+{
+	if(!freedIds.empty() &&
+	   std::chrono::steady_clock::now() - freedIds.front().second >= ID_QUARANTINE_PERIOD)
+	{
+		const uint32_t id = freedIds.front().first;
+		freedIds.pop();
+		return id;
+	}
+	return nextId++;
+}
+
+void Lobby::ReleaseId(uint32_t id)
+{
+	freedIds.emplace(id, std::chrono::steady_clock::now());
+}
+
 } // namespace Ignis::Multirole
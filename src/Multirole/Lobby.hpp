@@ -1,7 +1,9 @@
 #ifndef LOBBY_HPP
 #define LOBBY_HPP
+#include <chrono>
 #include <functional>
 #include <list>
+#include <queue>
 #include <shared_mutex>
 #include <random>
 #include <unordered_map>
@@ -49,13 +51,24 @@ public:
 	void IncrementConnectionCount(const std::string& ip);
 	void DecrementConnectionCount(const std::string& ip);
 private:
+	using FreedId = std::pair<uint32_t, std::chrono::steady_clock::time_point>;
+
 	const int maxConnections;
 	std::mt19937 rng;
 	bool closed;
 	std::unordered_map<uint32_t, std::weak_ptr<Room::Instance>> rooms;
-	mutable std::shared_mutex mRooms;
+	uint32_t nextId;
+	std::queue<FreedId> freedIds; // Ordered by time of release.
+	mutable std::shared_mutex mRooms; // used for rooms, nextId and freedIds.
 	std::unordered_map<std::string, int> connections;
 	mutable std::shared_mutex mConnections;
+
+	// Returns an id not used by any room in constant time, reusing ids of
+	// removed rooms only after they have been free for a while so clients
+	// with an outdated room list don't end up joining the wrong room.
+	// NOTE: mRooms must be locked before calling these.
+	uint32_t AllocateId();
+	void ReleaseId(uint32_t id);
 };
 
 } // namespace Ignis::Multirole
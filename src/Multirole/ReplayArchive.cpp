@@ -0,0 +1,236 @@
+#include "ReplayArchive.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib> // std::strtoul
+#include <cstring> // std::memcpy
+#include <string>
+
+#ifndef _WIN32
+#include <unistd.h> // fsync
+#endif // _WIN32
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+namespace Ignis::Multirole
+{
+
+namespace
+{
+
+constexpr const char* DATA_EXTENSION = ".yrpa";
+constexpr const char* INDEX_EXTENSION = ".yrpi";
+
+// NOTE: Entries are written field by field (native byte order) so there is
+// no padding on file: id, offset and length.
+constexpr std::size_t INDEX_ENTRY_SIZE = sizeof(uint64_t) * 2U + sizeof(uint32_t);
+
+using IndexEntryBuffer = std::array<char, INDEX_ENTRY_SIZE>;
+
+inline boost::filesystem::path SegmentPath(
+	const boost::filesystem::path& dir,
+	uint32_t segment,
+	const char* extension)
+{
+	return dir / (std::to_string(segment) + extension);
+}
+
+// Segment number of an archive file with the given extension, 0 otherwise.
+uint32_t SegmentFromPath(const boost::filesystem::path& p, const char* extension)
+{
+	if(p.extension() != extension)
+		return 0U;
+	const auto stem = p.stem().string();
+	char* end = nullptr;
+	const auto n = std::strtoul(stem.data(), &end, 10);
+	if(stem.empty() || *end != '\0' || n > UINT32_MAX)
+		return 0U;
+	return static_cast<uint32_t>(n);
+}
+
+// Flushes the file all the way to disk, not just to the OS.
+bool Sync(std::FILE* f) noexcept
+{
+	bool ok = std::fflush(f) == 0;
+#ifndef _WIN32
+	ok = ok && fsync(fileno(f)) == 0;
+#endif // _WIN32
+	return ok;
+}
+
+bool FlushAndClose(std::FILE* f) noexcept
+{
+	const bool ok = Sync(f);
+	return (std::fclose(f) == 0) && ok;
+}
+
+} // namespace
+
+// public
+
+ReplayArchive::ReplayArchive(
+	const boost::filesystem::path& dir,
+	uint64_t segmentSize,
+	std::chrono::seconds segmentLifetime)
+	:
+	dir(dir),
+	segmentSize(segmentSize),
+	segmentLifetime(segmentLifetime),
+	segment(0U),
+	data(nullptr),
+	index(nullptr),
+	dataSize(0U)
+{}
+
+ReplayArchive::~ReplayArchive() noexcept
+{
+	Close();
+}
+
+bool ReplayArchive::Append(uint64_t id, const std::vector<uint8_t>& bytes) noexcept
+{
+	if(data != nullptr &&
+	   ((dataSize != 0U && dataSize + bytes.size() > segmentSize) ||
+	   std::chrono::steady_clock::now() - opened >= segmentLifetime))
+		Close();
+	if(data == nullptr && !Open())
+		return false;
+	IndexEntryBuffer entry;
+	const auto length = static_cast<uint32_t>(bytes.size());
+	std::memcpy(entry.data(), &id, sizeof(id));
+	std::memcpy(entry.data() + sizeof(id), &dataSize, sizeof(dataSize));
+	std::memcpy(entry.data() + sizeof(id) + sizeof(dataSize), &length, sizeof(length));
+	// NOTE: If any of the writes fails the segment is left as is, and a new
+	// one is started with the next replay. The replay reaches the disk
+	// before its entry is written, so not even a power loss can leave an
+	// entry pointing to missing data; at worst the entry itself is lost.
+	if(std::fwrite(bytes.data(), 1U, bytes.size(), data) != bytes.size() ||
+	   !Sync(data) ||
+	   std::fwrite(entry.data(), entry.size(), 1U, index) != 1U ||
+	   std::fflush(index) != 0)
+	{
+		Close();
+		return false;
+	}
+	dataSize += bytes.size();
+	return true;
+}
+
+std::vector<ReplayArchive::Entry> ReplayArchive::ReadIndex(const boost::filesystem::path& dir)
+{
+	using namespace boost::filesystem;
+	std::vector<Entry> entries;
+	for(const auto& de : directory_iterator(dir))
+	{
+		const uint32_t seg = SegmentFromPath(de.path(), INDEX_EXTENSION);
+		if(seg == 0U)
+			continue;
+		ifstream f(de.path(), std::ios_base::binary);
+		IndexEntryBuffer buffer;
+		// NOTE: A trailing incomplete entry (crash while writing) is skipped.
+		while(f.read(buffer.data(), buffer.size()))
+		{
+			Entry& e = entries.emplace_back();
+			e.segment = seg;
+			std::memcpy(&e.id, buffer.data(), sizeof(e.id));
+			std::memcpy(&e.offset, buffer.data() + sizeof(e.id), sizeof(e.offset));
+			std::memcpy(&e.length, buffer.data() + sizeof(e.id) + sizeof(e.offset), sizeof(e.length));
+		}
+	}
+	// NOTE: Stable so entries of the same segment keep the order they were
+	// written in, then the last one of each id is kept.
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs)
+	{
+		return lhs.id < rhs.id || (lhs.id == rhs.id && lhs.segment < rhs.segment);
+	});
+	auto rit = std::unique(entries.rbegin(), entries.rend(), [](const Entry& lhs, const Entry& rhs)
+	{
+		return lhs.id == rhs.id;
+	});
+	entries.erase(entries.begin(), rit.base());
+	return entries;
+}
+
+const ReplayArchive::Entry* ReplayArchive::Find(const std::vector<Entry>& index, uint64_t id) noexcept
+{
+	auto it = std::lower_bound(index.begin(), index.end(), id, [](const Entry& e, uint64_t id)
+	{
+		return e.id < id;
+	});
+	if(it == index.end() || it->id != id)
+		return nullptr;
+	return &(*it);
+}
+
+std::optional<std::vector<uint8_t>> ReplayArchive::Read(
+	const boost::filesystem::path& dir,
+	const Entry& entry) noexcept
+{
+	try
+	{
+		boost::filesystem::ifstream f(SegmentPath(dir, entry.segment, DATA_EXTENSION), std::ios_base::binary);
+		if(!f.is_open() || !f.seekg(static_cast<std::streamoff>(entry.offset)))
+			return std::nullopt;
+		std::vector<uint8_t> bytes(entry.length);
+		if(!f.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+			return std::nullopt;
+		return bytes;
+	}
+	catch(const std::exception& /*unused*/)
+	{
+		return std::nullopt;
+	}
+}
+
+// private
+
+bool ReplayArchive::Open() noexcept
+{
+	try
+	{
+		if(segment == 0U)
+			for(const auto& de : boost::filesystem::directory_iterator(dir))
+				segment = std::max(segment, SegmentFromPath(de.path(), DATA_EXTENSION));
+		// NOTE: Exclusive creation, if another process took the number first
+		// then just try the next one.
+		do
+		{
+			if(segment == UINT32_MAX)
+				return false;
+			segment++;
+			const auto dp = SegmentPath(dir, segment, DATA_EXTENSION);
+			data = std::fopen(dp.string().data(), "wbx");
+		}
+		while(data == nullptr && errno == EEXIST);
+		if(data == nullptr)
+			return false;
+		const auto ip = SegmentPath(dir, segment, INDEX_EXTENSION);
+		if(index = std::fopen(ip.string().data(), "wb"); index == nullptr)
+		{
+			std::fclose(data);
+			data = nullptr;
+			return false;
+		}
+	}
+	catch(const std::exception& /*unused*/)
+	{
+		return false;
+	}
+	dataSize = 0U;
+	opened = std::chrono::steady_clock::now();
+	return true;
+}
+
+void ReplayArchive::Close() noexcept
+{
+	if(data == nullptr)
+		return;
+	FlushAndClose(data);
+	FlushAndClose(index);
+	data = nullptr;
+	index = nullptr;
+}
+
+} // namespace Ignis::Multirole
@@ -0,0 +1,77 @@
+#ifndef REPLAYARCHIVE_HPP
+#define REPLAYARCHIVE_HPP
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+namespace Ignis::Multirole
+{
+
+// Append-only storage of replays in a few large files instead of one file
+// per replay. The archive is a directory of numbered segments, each made of
+// two files:
+//	* "<n>.yrpa": The bytes of each replay, one after the other.
+//	* "<n>.yrpi": The index, one fixed-size entry per replay holding its id,
+//	  offset and length within the segment. Written once the replay itself
+//	  has been flushed to disk, so entries always point to complete data,
+//	  even after a power loss.
+// Every writer starts a segment of its own, so several processes can write
+// to the same archive at once (e.g: during a handoff). Segments are never
+// modified once closed, which makes them cheap to back up.
+class ReplayArchive final
+{
+public:
+	struct Entry
+	{
+		uint64_t id;
+		uint32_t segment;
+		uint32_t length;
+		uint64_t offset;
+	};
+
+	// Segments are closed once they reach segmentSize bytes or once they
+	// have been open for longer than segmentLifetime, whichever happens
+	// first. The next segment is created when the next replay is appended.
+	ReplayArchive(
+		const boost::filesystem::path& dir,
+		uint64_t segmentSize,
+		std::chrono::seconds segmentLifetime);
+	~ReplayArchive() noexcept;
+
+	// Appends a replay to the current segment. Not thread-safe.
+	bool Append(uint64_t id, const std::vector<uint8_t>& bytes) noexcept;
+
+	// Reads the entries of all the segments of the archive, sorted by id.
+	// Should an id appear more than once, only the newest entry is kept.
+	static std::vector<Entry> ReadIndex(const boost::filesystem::path& dir);
+
+	// Finds the entry of the given id in an index read with ReadIndex.
+	static const Entry* Find(const std::vector<Entry>& index, uint64_t id) noexcept;
+
+	// Reads the replay pointed to by the entry, std::nullopt if unable to.
+	static std::optional<std::vector<uint8_t>> Read(
+		const boost::filesystem::path& dir,
+		const Entry& entry) noexcept;
+private:
+	const boost::filesystem::path dir;
+	const uint64_t segmentSize;
+	const std::chrono::seconds segmentLifetime;
+	uint32_t segment; // Number of the current (or last) segment.
+	std::FILE* data;
+	std::FILE* index;
+	uint64_t dataSize;
+	std::chrono::steady_clock::time_point opened;
+
+	// Creates a new segment numbered after the highest one in the archive.
+	bool Open() noexcept;
+
+	// Flushes the current segment to disk and closes it.
+	void Close() noexcept;
+};
+
+} // namespace Ignis::Multirole
+
+#endif // REPLAYARCHIVE_HPP
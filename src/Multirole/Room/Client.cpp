@@ -16,7 +16,8 @@ Client::Client(
 	std::shared_ptr<Instance> r,
 	boost::asio::ip::tcp::socket socket,
 	std::string ip,
-	std::string name)
+	std::string name,
+	const IdleTimeouts& timeouts)
 	:
 	lobby(lobby),
 	room(std::move(r)),
@@ -24,6 +25,8 @@ Client::Client(
 	socket(std::move(socket)),
 	ip(std::move(ip)),
 	name(std::move(name)),
+	timeouts(timeouts),
+	lastActivity(timeouts.wheel.Now()),
 	connectionLost(false),
 	disconnecting(false),
 	position(POSITION_SPECTATOR),
@@ -47,6 +50,8 @@ void Client::Start()
 		room->Dispatch(Event::Join{*this});
 	});
 	DoReadHeader();
+	if(const auto m = std::max(timeouts.waiting, timeouts.dueling); m != 0U)
+		timeouts.wheel.Schedule(weak_from_this(), m);
 }
 
 const std::string& Client::Ip() const
@@ -126,6 +131,12 @@ void Client::Disconnect()
 		disconnecting = true;
 }
 
+void Client::OnTimeout() noexcept
+{
+	auto self(shared_from_this());
+	boost::asio::post(strand, [this, self](){CheckIdle();});
+}
+
 void Client::DoReadHeader()
 {
 	auto buffer = boost::asio::buffer(incoming.Data(), YGOPro::CTOSMsg::HEADER_LENGTH);
@@ -133,6 +144,7 @@ void Client::DoReadHeader()
 	boost::asio::async_read(socket, buffer, boost::asio::bind_executor(strand,
 	[this, self](boost::system::error_code ec, std::size_t /*unused*/)
 	{
+		lastActivity.store(timeouts.wheel.Now(), std::memory_order_relaxed);
 		if(!ec && incoming.IsHeaderValid())
 		{
 			DoReadBody();
@@ -176,6 +188,7 @@ void Client::DoWrite()
 	{
 		if(ec)
 			return;
+		lastActivity.store(timeouts.wheel.Now(), std::memory_order_relaxed);
 		std::scoped_lock lock(mOutgoing);
 		outgoing.pop();
 		if(!outgoing.empty())
@@ -191,6 +204,34 @@ void Client::Shutdown()
 	socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore);
 }
 
+void Client::CheckIdle()
+{
+	if(connectionLost || !socket.is_open())
+		return;
+	const auto limit = IdleLimit();
+	const auto idle = timeouts.wheel.Now() - lastActivity.load(std::memory_order_relaxed);
+	if(limit == 0U) // Not enforced on this state, check later.
+	{
+		timeouts.wheel.Schedule(weak_from_this(), std::max(timeouts.waiting, timeouts.dueling));
+		return;
+	}
+	if(idle >= limit)
+	{
+		Shutdown();
+		return;
+	}
+	timeouts.wheel.Schedule(weak_from_this(), static_cast<unsigned int>(limit - idle));
+}
+
+unsigned int Client::IdleLimit() const
+{
+	if(!room->Started())
+		return timeouts.waiting;
+	if(timeouts.dueling == 0U || position == POSITION_SPECTATOR)
+		return timeouts.dueling;
+	return timeouts.dueling + room->HostInfo().timeLimitInSeconds;
+}
+
 void Client::HandleMsg()
 {
 	switch(incoming.GetType())
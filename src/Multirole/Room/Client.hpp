@@ -1,5 +1,6 @@
 #ifndef ROOM_CLIENT_HPP
 #define ROOM_CLIENT_HPP
+#include <atomic>
 #include <utility>
 #include <queue>
 #include <mutex>
@@ -7,6 +8,7 @@
 #include <boost/asio/io_context_strand.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "../TimerWheel.hpp"
 #include "../YGOPro/CTOSMsg.hpp"
 #include "../YGOPro/Deck.hpp"
 #include "../YGOPro/STOCMsg.hpp"
@@ -21,13 +23,25 @@ namespace Room
 
 class Instance;
 
-class Client final : public std::enable_shared_from_this<Client>
+class Client final : public std::enable_shared_from_this<Client>, public TimerWheel::IEntry
 {
 public:
 	using PosType = std::pair<uint8_t, uint8_t>;
 	static constexpr PosType POSITION_SPECTATOR = {UINT8_MAX, UINT8_MAX};
 
-	Client(Lobby& lobby, std::shared_ptr<Instance> r, boost::asio::ip::tcp::socket socket, std::string ip, std::string name);
+	// Number of seconds a client can go without reading or writing anything
+	// before being disconnected, 0 disables the respective check.
+	struct IdleTimeouts
+	{
+		TimerWheel& wheel;
+		// While the room has not started.
+		unsigned int waiting;
+		// Once the room has started, for duelists the time limit of the room
+		// is added on top so the turn timer always expires first.
+		unsigned int dueling;
+	};
+
+	Client(Lobby& lobby, std::shared_ptr<Instance> r, boost::asio::ip::tcp::socket socket, std::string ip, std::string name, const IdleTimeouts& timeouts);
 	~Client();
 	void Start();
 
@@ -57,6 +71,9 @@ public:
 	// sets a flag if there are messages in the queue to disconnect
 	// upon finishing writes.
 	void Disconnect();
+
+	// TimerWheel::IEntry overrides
+	void OnTimeout() noexcept override;
 private:
 	Lobby& lobby;
 	std::shared_ptr<Instance> room;
@@ -64,6 +81,8 @@ private:
 	boost::asio::ip::tcp::socket socket;
 	const std::string ip;
 	const std::string name;
+	const IdleTimeouts& timeouts;
+	std::atomic<uint64_t> lastActivity;
 	bool connectionLost;
 	bool disconnecting;
 	PosType position;
@@ -87,6 +106,13 @@ private:
 
 	// Handles received CTOS message
 	void HandleMsg();
+
+	// Shuts down the client if it has been idle for longer than allowed
+	// on the current room state, otherwise checks again later.
+	void CheckIdle();
+
+	// Idle timeout that applies right now, 0 if disabled.
+	unsigned int IdleLimit() const;
 };
 
 } // namespace Room
@@ -1,8 +1,11 @@
 #include "Context.hpp"
 
+#include <algorithm>
+
 #include "../I18N.hpp"
 #include "../STOCMsgFactory.hpp"
 #include "../Service/DataProvider.hpp"
+#include "../Service/DeckCache.hpp"
 #include "../Service/LogHandler.hpp"
 #include "../YGOPro/Banlist.hpp"
 #include "../YGOPro/CardDatabase.hpp"
@@ -16,6 +19,7 @@ Context::Context(CreateInfo&& info) noexcept
 	:
 	STOCMsgFactory(info.hostInfo.t0Count),
 	svc(info.svc),
+	room(info.room),
 	tagg(info.tagg),
 	id(info.id),
 	banlist(std::move(info.banlist)),
@@ -156,65 +160,77 @@ std::unique_ptr<YGOPro::Deck> Context::LoadDeck(
 	const std::vector<uint32_t>& main,
 	const std::vector<uint32_t>& side) const noexcept
 {
-	auto IsExtraDeckCardType = [](uint32_t type) constexpr -> bool
-	{
-		if((type & (TYPE_FUSION | TYPE_SYNCHRO | TYPE_XYZ)) != 0U)
-			return true;
-		// NOTE: Link Spells exist.
-		if(((type & TYPE_LINK) != 0U) && ((type & TYPE_MONSTER) != 0U))
-			return true;
-		return false;
-	};
-	YGOPro::CodeVector m;
-	YGOPro::CodeVector e;
-	YGOPro::CodeVector s;
-	uint32_t err = 0U;
-	for(const auto code : main)
+	return std::make_unique<YGOPro::Deck>(svc.deckCache.GetDeck(cdb, main, side, [&]()
 	{
-		const auto& data = cdb->DataFromCode(code);
-		if(data.code == 0U)
+		auto IsExtraDeckCardType = [](uint32_t type) constexpr -> bool
 		{
-			err = code;
-			continue;
+			if((type & (TYPE_FUSION | TYPE_SYNCHRO | TYPE_XYZ)) != 0U)
+				return true;
+			// NOTE: Link Spells exist.
+			if(((type & TYPE_LINK) != 0U) && ((type & TYPE_MONSTER) != 0U))
+				return true;
+			return false;
+		};
+		YGOPro::CodeVector m;
+		YGOPro::CodeVector e;
+		YGOPro::CodeVector s;
+		uint32_t err = 0U;
+		for(const auto code : main)
+		{
+			const auto data = cdb->DataFromCode(code);
+			if(data.code == 0U)
+			{
+				err = code;
+				continue;
+			}
+			if((data.type & TYPE_TOKEN) != 0U)
+				continue;
+			if(IsExtraDeckCardType(data.type))
+				e.push_back(code);
+			else
+				m.push_back(code);
 		}
-		if((data.type & TYPE_TOKEN) != 0U)
-			continue;
-		if(IsExtraDeckCardType(data.type))
-			e.push_back(code);
-		else
-			m.push_back(code);
-	}
-	for(const auto code : side)
-	{
-		const auto& data = cdb->DataFromCode(code);
-		if(data.code == 0U)
+		for(const auto code : side)
 		{
-			err = code;
-			continue;
+			const auto data = cdb->DataFromCode(code);
+			if(data.code == 0U)
+			{
+				err = code;
+				continue;
+			}
+			if((data.type & TYPE_TOKEN) != 0U)
+				continue;
+			s.push_back(code);
 		}
-		if((data.type & TYPE_TOKEN) != 0U)
-			continue;
-		s.push_back(code);
-	}
-	return std::make_unique<YGOPro::Deck>(
-		std::move(m),
-		std::move(e),
-		std::move(s),
-		err);
+		return YGOPro::Deck(
+			std::move(m),
+			std::move(e),
+			std::move(s),
+			err);
+	}));
+}
+
+std::shared_ptr<const YGOPro::STOCMsg> Context::CheckDeck(const YGOPro::Deck& deck) const noexcept
+{
+	return svc.deckCache.GetVerdict(deck, {cdb, banlist, limits, hostInfo.allowed, hostInfo.forb},
+	[&]()
+	{
+		return ValidateDeck(deck);
+	});
 }
 
-std::unique_ptr<YGOPro::STOCMsg> Context::CheckDeck(const YGOPro::Deck& deck) const noexcept
+std::shared_ptr<const YGOPro::STOCMsg> Context::ValidateDeck(const YGOPro::Deck& deck) const noexcept
 {
 	using namespace Error;
 	using namespace YGOPro;
 	// Handy shortcuts.
 	auto MakeErrorPtr = [](DeckOrCard type, uint32_t value)
 	{
-		return std::make_unique<STOCMsg>(MakeDeckError(type, value));
+		return std::make_shared<const STOCMsg>(MakeDeckError(type, value));
 	};
 	auto MakeErrorLimitsPtr = [](DeckOrCard type, std::size_t got, const auto& lim)
 	{
-		return std::make_unique<STOCMsg>(
+		return std::make_shared<const STOCMsg>(
 			MakeDeckError(type, got, lim.min, lim.max));
 	};
 	// Check if the deck had any error while loading.
@@ -233,42 +249,41 @@ std::unique_ptr<YGOPro::STOCMsg> Context::CheckDeck(const YGOPro::Deck& deck) co
 	if(const auto p = OutOfBound(limits.side, deck.Side()); p.second)
 		return MakeErrorLimitsPtr(DECK_BAD_SIDE_COUNT, p.first, limits.side);
 	// Check per-code properties.
-	// Get un-aliased map that will be updated a bit later...
-	auto aliased = deck.GetCodeMap();
-	// Make copy of "un-aliased" card codes.
-	const auto codes = [&aliased]()
+	// Gather all the cards along with the code they are counted as, which
+	// is their alias if they have one. Sorted by code so each different
+	// card is checked once.
+	struct DeckCard
 	{
-		std::set<uint32_t> ret;
-		for(const auto& kv : aliased)
-			ret.insert(kv.first);
-		return ret;
-	}();
-	// Save alias mapping while updating map to only store aliased counts.
-	const auto aliases = [&]()
+		uint32_t code;
+		uint32_t group;
+		const CardDatabase::Card* card;
+	};
+	std::vector<DeckCard> cards;
+	std::vector<uint32_t> groups;
+	cards.reserve(deck.Main().size() + deck.Extra().size() + deck.Side().size());
+	for(const auto* from : {&deck.Main(), &deck.Extra(), &deck.Side()})
 	{
-		std::map<uint32_t, uint32_t> ret;
-		for(auto it = aliased.begin(), last = aliased.end(); it != last;)
+		for(const auto code : *from)
 		{
-			uint32_t code = it->first;
-			if(uint32_t alias = cdb->DataFromCode(code).alias; alias != 0U)
-			{
-				ret[code] = alias;
-				aliased[alias] = aliased[alias] + it->second;
-				it = aliased.erase(it);
-			}
-			else
-			{
-				++it;
-			}
+			const auto* card = cdb->CardFromCode(code);
+			if(card == nullptr)
+				return MakeErrorPtr(CARD_UNKNOWN, code);
+			cards.push_back({code, (card->alias != 0U) ? card->alias : code, card});
 		}
-		return ret;
-	}();
+	}
+	std::sort(cards.begin(), cards.end(), [](const DeckCard& lhs, const DeckCard& rhs)
+	{
+		return lhs.code < rhs.code;
+	});
+	groups.reserve(cards.size());
+	for(const auto& dc : cards)
+		groups.push_back(dc.group);
+	std::sort(groups.begin(), groups.end());
 	// Fetch actual count of particular card even if aliased.
-	auto GetTotalCount = [&aliased, &aliases](uint32_t code) -> std::size_t
+	auto GetTotalCount = [&groups](uint32_t group) -> std::size_t
 	{
-		if(auto search = aliases.find(code); search != aliases.end())
-			return aliased[search->second];
-		return aliased[code];
+		const auto range = std::equal_range(groups.cbegin(), groups.cend(), group);
+		return static_cast<std::size_t>(range.second - range.first);
 	};
 	// Custom predicates...
 	//	true if card scope is unnofficial and not allowed.
@@ -302,26 +317,17 @@ std::unique_ptr<YGOPro::STOCMsg> Context::CheckDeck(const YGOPro::Deck& deck) co
 	{
 		return allowed == ALLOWED_CARDS_TCG_ONLY && ((scope & SCOPE_TCG) == 0U);
 	};
-	//	true if card code and its count is banlisted.
-	auto CheckBanlist = [&](uint32_t code, std::size_t count, const Banlist& bl) -> bool
-	{
-		const auto& d = bl.Dict();
-		const auto eit = d.end();
-		auto it = d.find(code);
-		if(it == eit)
-			if(auto search = aliases.find(code); search != aliases.end())
-				it = d.find(search->second);
-		return ((it != eit) && static_cast<int32_t>(count) > it->second) ||
-		       ((it == eit) && bl.IsWhitelist());
-	};
-	for(const auto code : codes)
+	for(auto it = cards.cbegin(), last = cards.cend(); it != last; ++it)
 	{
-		const uint32_t totalCount = GetTotalCount(code);
+		if(it != cards.cbegin() && it->code == (it - 1)->code)
+			continue;
+		const uint32_t code = it->code;
+		const std::size_t totalCount = GetTotalCount(it->group);
 		if(totalCount > 3U)
 			return MakeErrorPtr(CARD_MORE_THAN_3, code);
-		if((cdb->DataFromCode(code).type & hostInfo.forb) != 0U)
+		if((it->card->type & hostInfo.forb) != 0U)
 			return MakeErrorPtr(CARD_FORBIDDEN_TYPE, code);
-		const auto& ced = cdb->ExtraFromCode(code);
+		const auto& ced = it->card->extra;
 		if(CheckUnofficial(ced.scope, hostInfo.allowed))
 			return MakeErrorPtr(CARD_UNOFFICIAL, code);
 		if(CheckPrelease(ced.scope, hostInfo.allowed))
@@ -330,7 +336,8 @@ std::unique_ptr<YGOPro::STOCMsg> Context::CheckDeck(const YGOPro::Deck& deck) co
 			return MakeErrorPtr(CARD_TCG_ONLY, code);
 		if(CheckTCG(ced.scope, hostInfo.allowed))
 			return MakeErrorPtr(CARD_OCG_ONLY, code);
-		if((banlist != nullptr) && CheckBanlist(code, totalCount, *banlist))
+		// NOTE: Banlists are compiled with aliases already resolved.
+		if((banlist != nullptr) && static_cast<int32_t>(totalCount) > banlist->Limit(code))
 			return MakeErrorPtr(CARD_BANLISTED, code);
 	}
 	return nullptr;
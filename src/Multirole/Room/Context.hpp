@@ -28,6 +28,7 @@ class RoomLogger;
 namespace Room
 {
 
+class Instance;
 class TimerAggregator;
 
 class Context : public STOCMsgFactory
@@ -37,6 +38,7 @@ public:
 	struct CreateInfo
 	{
 		Service& svc;
+		Instance& room;
 		TimerAggregator& tagg;
 		uint32_t id;
 		uint32_t seed;
@@ -84,6 +86,10 @@ public:
 	StateOpt operator()(State::Dueling& s, const Event::Response& e) noexcept;
 	StateOpt operator()(State::Dueling& s, const Event::Surrender& e) noexcept;
 	StateOpt operator()(State::Dueling& s, const Event::TimerExpired& e) noexcept;
+	// State/Finishing.cpp
+	StateOpt operator()(State::Finishing& s, const Event::ConnectionLost& e) noexcept;
+	StateOpt operator()(State::Finishing&, const Event::Join& e) noexcept;
+	StateOpt operator()(State::Finishing& s, const Event::ReplayReady& e) noexcept;
 	// State/Rematching.cpp
 	StateOpt operator()(State::Rematching&) noexcept;
 	StateOpt operator()(State::Rematching&, const Event::ConnectionLost& e) noexcept;
@@ -134,6 +140,7 @@ public:
 private:
 	// Creation options and resources.
 	Service& svc;
+	Instance& room;
 	TimerAggregator& tagg;
 	const uint32_t id;
 	const YGOPro::BanlistPtr banlist;
@@ -187,17 +194,25 @@ private:
 	// Creates a YGOPro::Deck from the given vectors, making sure
 	// that the deck is only composed of non-zero card codes, also,
 	// sets its internal error to whatever was the lastest unknown card.
+	// NOTE: Decks are cached, see Service::DeckCache.
 	std::unique_ptr<YGOPro::Deck> LoadDeck(
 		const std::vector<uint32_t>& main,
 		const std::vector<uint32_t>& side) const noexcept;
 
-	// Check if a given deck is valid on the current room options.
-	std::unique_ptr<YGOPro::STOCMsg> CheckDeck(const YGOPro::Deck& deck) const noexcept;
+	// Check if a given deck is valid on the current room options,
+	// returns the error message to send if not valid.
+	// NOTE: Results are cached, see Service::DeckCache.
+	std::shared_ptr<const YGOPro::STOCMsg> CheckDeck(const YGOPro::Deck& deck) const noexcept;
+
+	// Uncached version of CheckDeck.
+	std::shared_ptr<const YGOPro::STOCMsg> ValidateDeck(const YGOPro::Deck& deck) const noexcept;
 
 	/*** STATE SPECIFIC FUNCTIONS ***/
 	// State/Dueling.cpp
 	Client& GetCurrentTeamClient(State::Dueling& s, uint8_t team) noexcept;
 	std::optional<DuelFinishReason> Process(State::Dueling& s) noexcept;
+	// NOTE: The replay is compressed in the background, the room waits on
+	// State::Finishing until it can be sent.
 	StateVariant Finish(State::Dueling& s, const DuelFinishReason& dfr) noexcept;
 	static const YGOPro::STOCMsg& SaveToSpectatorCache(
 		State::Dueling& s,
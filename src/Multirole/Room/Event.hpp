@@ -56,6 +56,11 @@ struct Rematch
 	bool answer;
 };
 
+struct ReplayReady
+{
+	const std::vector<uint8_t>& bytes;
+};
+
 struct Response
 {
 	Client& client;
@@ -111,6 +116,7 @@ using EventVariant = std::variant<
 	Event::Join,
 	Event::Ready,
 	Event::Rematch,
+	Event::ReplayReady,
 	Event::Response,
 	Event::Surrender,
 	Event::TimerExpired,
@@ -11,6 +11,7 @@ Instance::Instance(CreateInfo& info)
 	pass(std::move(info.pass)),
 	ctx({
 		info.svc,
+		*this,
 		tagg,
 		info.id,
 		info.seed,
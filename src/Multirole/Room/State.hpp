@@ -41,7 +41,7 @@ struct Dueling
 	std::shared_ptr<Core::IWrapper> core;
 	void* duelPtr;
 	uint64_t replayId;
-	std::unique_ptr<YGOPro::Replay> replay;
+	std::shared_ptr<YGOPro::Replay> replay;
 	std::array<uint8_t, 2U> currentPos;
 	std::array<uint8_t, 2U> retryCount;
 	std::vector<uint8_t> lastHint;
@@ -52,6 +52,18 @@ struct Dueling
 	std::array<std::chrono::milliseconds, 2U> timeRemaining;
 };
 
+struct Finishing
+{
+	// Where the room goes once the replay is sent.
+	enum class Next : uint8_t
+	{
+		REMATCHING,
+		SIDEDECKING,
+		CLOSING,
+	} next;
+	Client* turnDecider;
+};
+
 struct Rematching
 {
 	Client* turnChooser;
@@ -80,10 +92,11 @@ using StateVariant = std::variant<
 	State::ChoosingTurn,     // 0
 	State::Closing,          // 1
 	State::Dueling,          // 2
-	State::Rematching,       // 3
-	State::RockPaperScissor, // 4
-	State::Sidedecking,      // 5
-	State::Waiting>;         // 6
+	State::Finishing,        // 3
+	State::Rematching,       // 4
+	State::RockPaperScissor, // 5
+	State::Sidedecking,      // 6
+	State::Waiting>;         // 7
 
 using StateOpt = std::optional<StateVariant>;
 
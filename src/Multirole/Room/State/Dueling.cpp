@@ -1,5 +1,8 @@
 #include "../Context.hpp"
 
+#include <boost/asio/post.hpp>
+
+#include "../Instance.hpp"
 #include "../TimerAggregator.hpp"
 #include "../../I18N.hpp"
 #include "../../Core/IWrapper.hpp"
@@ -68,7 +71,7 @@ StateOpt Context::operator()(State::Dueling& s) noexcept
 		using namespace std::chrono;
 		return system_clock::to_time_t(system_clock::now());
 	};
-	s.replay = std::make_unique<YGOPro::Replay>
+	s.replay = std::make_shared<YGOPro::Replay>
 	(
 		static_cast<uint32_t>(CurrentTime()),
 		seed,
@@ -97,8 +100,8 @@ StateOpt Context::operator()(State::Dueling& s) noexcept
 		s.duelPtr = s.core->CreateDuel(dopts);
 		auto LoadScript = [&](std::string_view file)
 		{
-			if(auto scr = svc.scriptProvider.ScriptFromFilePath(file); !scr.empty())
-				s.core->LoadScript(s.duelPtr, file, scr);
+			if(auto scr = svc.scriptProvider.ScriptFromFilePath(file); !scr->empty())
+				s.core->LoadScript(s.duelPtr, file, *scr);
 		};
 		LoadScript("constant.lua");
 		LoadScript("utility.lua");
@@ -236,7 +239,14 @@ StateOpt Context::operator()(State::Dueling& s, const Event::ConnectionLost& e)
 		return std::nullopt;
 	}
 	uint8_t winner = 1U - p.first;
-	return Finish(s, DuelFinishReason{Reason::REASON_CONNECTION_LOST, winner});
+	auto next = Finish(s, DuelFinishReason{Reason::REASON_CONNECTION_LOST, winner});
+	// NOTE: The client is gone once this returns, but the room keeps on
+	// sending to the rest until the replay is ready.
+	{
+		std::scoped_lock lock(mDuelists);
+		duelists.erase(p);
+	}
+	return next;
 }
 
 StateOpt Context::operator()(State::Dueling& s, const Event::Join& e) noexcept
@@ -564,78 +574,76 @@ StateVariant Context::Finish(State::Dueling& s, const DuelFinishReason& dfr) noe
 		s.replay->RecordMsg(winMsg);
 		SendToAll(MakeGameMsg(winMsg));
 	};
-	auto SendReplay = [&]()
-	{
-		s.replay->Serialize();
-		svc.replayManager.Save(s.replayId, *s.replay);
-		if(s.replay->Bytes().size() > YGOPro::STOCMsg::MAX_PAYLOAD_SIZE)
-			SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_REPLAY_TOO_BIG));
-		else
-			SendToAll(MakeSendReplay(s.replay->Bytes()));
-		SendToAll(MakeOpenReplayPrompt());
-	};
-	auto* turnDecider = [&]() -> Client*
+	auto TurnDecider = [&]() -> Client*
 	{
 		if(dfr.winner <= 1U)
 			return duelists[{1U - dfr.winner, 0U}];
 		return duelists[{0U, 0U}];
-	}();
-	switch(dfr.reason)
-	{
-	case Reason::REASON_DUEL_WON:
-	case Reason::REASON_SURRENDERED:
-	case Reason::REASON_TIMED_OUT:
-	case Reason::REASON_WRONG_RESPONSE:
+	};
+	using Next = State::Finishing::Next;
+	auto next = [&]() -> State::Finishing
 	{
-		// Send corresponding game finishing messages
-		if(dfr.reason == Reason::REASON_SURRENDERED)
-			SendWinMsg(WIN_REASON_SURRENDERED);
-		else if(dfr.reason == Reason::REASON_TIMED_OUT)
-			SendWinMsg(WIN_REASON_TIMED_OUT);
-		else if(dfr.reason == Reason::REASON_WRONG_RESPONSE)
-			SendWinMsg(WIN_REASON_WRONG_RESPONSE);
-		SendReplay();
-		if(hostInfo.bestOf <= 1) // Single.
-			return State::Rematching{turnDecider, {}};
-		// Match.
-		duelsHad++;
-		if(dfr.winner != 2U)
-		{
-			wins[dfr.winner] += (s.matchKillReason.has_value()) ? neededWins : 1U;
-			if(wins[dfr.winner] >= neededWins)
+		switch(dfr.reason)
+		{
+		case Reason::REASON_DUEL_WON:
+		case Reason::REASON_SURRENDERED:
+		case Reason::REASON_TIMED_OUT:
+		case Reason::REASON_WRONG_RESPONSE:
+		{
+			// Send corresponding game finishing messages
+			if(dfr.reason == Reason::REASON_SURRENDERED)
+				SendWinMsg(WIN_REASON_SURRENDERED);
+			else if(dfr.reason == Reason::REASON_TIMED_OUT)
+				SendWinMsg(WIN_REASON_TIMED_OUT);
+			else if(dfr.reason == Reason::REASON_WRONG_RESPONSE)
+				SendWinMsg(WIN_REASON_WRONG_RESPONSE);
+			if(hostInfo.bestOf <= 1) // Single.
+				return {Next::REMATCHING, TurnDecider()};
+			// Match.
+			duelsHad++;
+			if(dfr.winner != 2U)
 			{
-				SendToAll(MakeDuelEnd());
-				return State::Closing{};
+				wins[dfr.winner] += (s.matchKillReason.has_value()) ? neededWins : 1U;
+				if(wins[dfr.winner] >= neededWins)
+					return {Next::CLOSING, nullptr};
 			}
+			else if(!IsTiebreaking() && duelsHad >= hostInfo.bestOf)
+			{
+				return {Next::CLOSING, nullptr};
+			}
+			return {Next::SIDEDECKING, TurnDecider()};
 		}
-		else if(!IsTiebreaking() && duelsHad >= hostInfo.bestOf)
+		case Reason::REASON_CORE_CRASHED:
 		{
-			SendToAll(MakeDuelEnd());
-			return State::Closing{};
+			SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_CORE_EXCEPT));
+			SendWinMsg(WIN_REASON_INTERNAL_ERROR);
+			if(hostInfo.bestOf <= 1)
+				return {Next::REMATCHING, TurnDecider()};
+			return {Next::SIDEDECKING, TurnDecider()};
 		}
-		return State::Sidedecking{turnDecider, {}};
-	}
-	case Reason::REASON_CORE_CRASHED:
-	{
-		SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_CORE_EXCEPT));
-		SendWinMsg(WIN_REASON_INTERNAL_ERROR);
-		SendReplay();
-		if(hostInfo.bestOf <= 1)
-			return State::Rematching{turnDecider, {}};
-		return State::Sidedecking{turnDecider, {}};
-	}
-	case Reason::REASON_CONNECTION_LOST:
-	{
-		SendWinMsg(WIN_REASON_CONNECTION_LOST);
-		[[fallthrough]];
-	}
-	default:
+		case Reason::REASON_CONNECTION_LOST:
+		{
+			SendWinMsg(WIN_REASON_CONNECTION_LOST);
+			[[fallthrough]];
+		}
+		default:
+		{
+			return {Next::CLOSING, nullptr};
+		}
+		}
+	}();
+	// Compress (and save) the replay off the room's strand, it is sent (and
+	// the room moves on) once that is done, see State/Finishing.cpp.
+	svc.replayManager.AsyncSerialize(s.replayId, s.replay, YGOPro::STOCMsg::MAX_PAYLOAD_SIZE,
+	[self = room.shared_from_this()](std::vector<uint8_t> bytes)
 	{
-		SendReplay();
-		SendToAll(MakeDuelEnd());
-		return State::Closing{};
-	}
-	}
+		boost::asio::post(self->Strand(),
+		[self, bytes = std::move(bytes)]()
+		{
+			self->Dispatch(Event::ReplayReady{bytes});
+		});
+	});
+	return next;
 }
 
 const YGOPro::STOCMsg& Context::SaveToSpectatorCache(
@@ -0,0 +1,53 @@
+#include "../Context.hpp"
+
+#include "../../I18N.hpp"
+
+namespace Ignis::Multirole::Room
+{
+
+StateOpt Context::operator()(State::Finishing& s, const Event::ConnectionLost& e) noexcept
+{
+	const auto p = e.client.Position();
+	if(p == Client::POSITION_SPECTATOR)
+	{
+		spectators.erase(&e.client);
+		return std::nullopt;
+	}
+	// NOTE: The rest still get the replay before the room is closed.
+	{
+		std::scoped_lock lock(mDuelists);
+		duelists.erase(p);
+	}
+	s.next = State::Finishing::Next::CLOSING;
+	return std::nullopt;
+}
+
+StateOpt Context::operator()(State::Finishing& /*unused*/, const Event::Join& e) noexcept
+{
+	SetupAsSpectator(e.client);
+	e.client.Send(MakeDuelStart());
+	return std::nullopt;
+}
+
+StateOpt Context::operator()(State::Finishing& s, const Event::ReplayReady& e) noexcept
+{
+	if(e.bytes.size() > YGOPro::STOCMsg::MAX_PAYLOAD_SIZE)
+		SendToAll(MakeChat(CHAT_MSG_TYPE_ERROR, I18N::CLIENT_ROOM_REPLAY_TOO_BIG));
+	else
+		SendToAll(MakeSendReplay(e.bytes));
+	SendToAll(MakeOpenReplayPrompt());
+	using Next = State::Finishing::Next;
+	switch(s.next)
+	{
+	case Next::REMATCHING:
+		return State::Rematching{s.turnDecider, {}};
+	case Next::SIDEDECKING:
+		return State::Sidedecking{s.turnDecider, {}};
+	case Next::CLOSING:
+		break;
+	}
+	SendToAll(MakeDuelEnd());
+	return State::Closing{};
+}
+
+} // namespace Ignis::Multirole::Room
@@ -2,29 +2,66 @@
 
 #include <fstream>
 
+#include "DataProvider.hpp"
 #include "LogHandler.hpp"
 #define LOG_INFO(...) lh.Log(ServiceType::BANLIST_PROVIDER, Level::INFO, __VA_ARGS__)
 #define LOG_ERROR(...) lh.Log(ServiceType::BANLIST_PROVIDER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
 #define YGOPRO_BANLIST_PARSER_IMPLEMENTATION
 #include "../YGOPro/BanlistParser.hpp"
+#include "../YGOPro/CardDatabase.hpp"
 
 namespace Ignis::Multirole
 {
 
-Service::BanlistProvider::BanlistProvider(Service::LogHandler& lh, std::string_view fnRegexStr) :
+namespace
+{
+
+YGOPro::BanlistMap Compile(const YGOPro::BanlistMap& parsed, const YGOPro::CardDatabase& db)
+{
+	YGOPro::BanlistMap compiled;
+	compiled.reserve(parsed.size());
+	for(const auto& kv : parsed)
+		compiled.emplace(kv.first, std::make_shared<YGOPro::Banlist>(*kv.second, db));
+	return compiled;
+}
+
+} // namespace
+
+Service::BanlistProvider::BanlistProvider(Service::LogHandler& lh, const Service::DataProvider& dataProvider, std::string_view fnRegexStr) :
 	lh(lh),
-	fnRegex(fnRegexStr.data())
+	dataProvider(dataProvider),
+	fnRegex(fnRegexStr.data()),
+	gen(std::make_shared<Generation>())
 {}
 
 YGOPro::BanlistPtr Service::BanlistProvider::GetBanlistByHash(YGOPro::BanlistHash hash) const noexcept
 {
-	std::shared_lock lock(mBanlists);
-	if(auto search = banlists.find(hash); search != banlists.end())
+	auto current = [&]()
+	{
+		std::shared_lock lock(mGen);
+		return gen;
+	}();
+	if(auto search = current->compiled.find(hash); search != current->compiled.end())
 		return search->second;
 	return nullptr;
 }
 
+void Service::BanlistProvider::OnDatabaseReload(std::shared_ptr<YGOPro::CardDatabase> db) noexcept
+{
+	std::scoped_lock clock(mCompile);
+	auto current = [&]()
+	{
+		std::shared_lock lock(mGen);
+		return gen;
+	}();
+	// NOTE: Banlists loaded right after the database are already compiled.
+	if(current->db == db)
+		return;
+	auto parsed = current->parsed;
+	Publish(std::move(parsed), std::move(db));
+}
+
 void Service::BanlistProvider::OnAdd(const boost::filesystem::path& path, const PathVector& fileList)
 {
 	LoadBanlists(path, fileList);
@@ -56,11 +93,41 @@ void Service::BanlistProvider::LoadBanlists(const boost::filesystem::path& path,
 			LOG_ERROR(I18N::BANLIST_PROVIDER_COULD_NOT_LOAD_ONE, e.what());
 		}
 	}
-	std::scoped_lock lock(mBanlists);
+	// Make the new generation, only the banlists that were loaded are
+	// replaced, then compile all of them against the current database.
+	std::scoped_lock clock(mCompile);
+	auto parsed = [&]()
+	{
+		std::shared_lock lock(mGen);
+		return gen->parsed;
+	}();
 	// Delete banlists that have the same hash (`merge` does not replace them)
 	for(const auto& kv : tmp)
-		banlists.erase(kv.first);
-	banlists.merge(tmp);
+		parsed.erase(kv.first);
+	parsed.merge(tmp);
+	Publish(std::move(parsed), dataProvider.GetDatabase());
+}
+
+void Service::BanlistProvider::Publish(YGOPro::BanlistMap&& parsed, std::shared_ptr<YGOPro::CardDatabase> db) noexcept
+{
+	auto newGen = std::make_shared<Generation>();
+	newGen->parsed = std::move(parsed);
+	try
+	{
+		newGen->db = std::move(db);
+		if(newGen->db)
+			newGen->compiled = Compile(newGen->parsed, *newGen->db);
+		else
+			newGen->compiled = newGen->parsed;
+	}
+	catch(const std::exception& e)
+	{
+		LOG_ERROR(I18N::BANLIST_PROVIDER_COULD_NOT_COMPILE, e.what());
+		newGen->db.reset();
+		newGen->compiled = newGen->parsed;
+	}
+	std::scoped_lock lock(mGen);
+	gen = std::move(newGen);
 }
 
 } // namespace Ignis::Multirole
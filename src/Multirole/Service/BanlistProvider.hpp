@@ -2,32 +2,65 @@
 #define SERVICE_BANLISTPROVIDER_HPP
 #include "../Service.hpp"
 
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <shared_mutex>
 
 #include "../IGitRepoObserver.hpp"
 #include "../YGOPro/BanlistParser.hpp"
 
+namespace YGOPro
+{
+
+class CardDatabase;
+
+} // namespace YGOPro
+
 namespace Ignis::Multirole
 {
 
 class Service::BanlistProvider final : public IGitRepoObserver
 {
 public:
-	BanlistProvider(Service::LogHandler& lh, std::string_view fnRegexStr);
+	BanlistProvider(Service::LogHandler& lh, const Service::DataProvider& dataProvider, std::string_view fnRegexStr);
 
+	// Returns the banlist compiled against the current card database.
 	YGOPro::BanlistPtr GetBanlistByHash(YGOPro::BanlistHash hash) const noexcept;
 
+	// Compiles the banlists again against a database the data provider
+	// just loaded, from the thread that loaded it.
+	void OnDatabaseReload(std::shared_ptr<YGOPro::CardDatabase> db) noexcept;
+
 	// IGitRepoObserver overrides
 	void OnAdd(const boost::filesystem::path& path, const PathVector& fileList) override;
 	void OnDiff(const boost::filesystem::path& path, const GitDiff& diff) override;
 private:
+	struct Generation
+	{
+		YGOPro::BanlistMap parsed;
+		std::shared_ptr<YGOPro::CardDatabase> db;
+		YGOPro::BanlistMap compiled; // Compiled against db.
+	};
+
 	Service::LogHandler& lh;
+	const Service::DataProvider& dataProvider;
 	const std::regex fnRegex;
-	YGOPro::BanlistMap banlists;
-	mutable std::shared_mutex mBanlists;
+	// Replaced as a whole by each load, or whenever the card database
+	// changes, sharing unchanged parsed banlists with the previous one.
+	// mGen is only held to copy the pointer (shared) or to replace it
+	// (exclusive), never while compiling; making the next generation is
+	// serialized by mCompile instead.
+	std::shared_ptr<const Generation> gen;
+	mutable std::shared_mutex mGen;
+	std::mutex mCompile;
 
 	void LoadBanlists(const boost::filesystem::path& path, const PathVector& fileList) noexcept;
+
+	// Compiles the banlists against db, if any, then replaces the current
+	// generation with the result.
+	// NOTE: mCompile must be locked.
+	void Publish(YGOPro::BanlistMap&& parsed, std::shared_ptr<YGOPro::CardDatabase> db) noexcept;
 };
 
 } // namespace Ignis::Multirole
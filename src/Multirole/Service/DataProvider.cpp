@@ -3,6 +3,8 @@
 #include <cstring> // std::memset
 #include <stdexcept> // std::runtime_error
 
+#include <boost/container_hash/hash.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <sqlite3.h>
 
 #include "LogHandler.hpp"
@@ -16,9 +18,10 @@ namespace Ignis::Multirole
 
 // public
 
-Service::DataProvider::DataProvider(Service::LogHandler& lh, std::string_view fnRegexStr) :
+Service::DataProvider::DataProvider(Service::LogHandler& lh, std::string_view fnRegexStr, std::string_view imagePath) :
 	lh(lh),
-	fnRegex(fnRegexStr.data())
+	fnRegex(fnRegexStr.data()),
+	imagePath(imagePath)
 {}
 
 std::shared_ptr<YGOPro::CardDatabase> Service::DataProvider::GetDatabase() const noexcept
@@ -27,6 +30,16 @@ std::shared_ptr<YGOPro::CardDatabase> Service::DataProvider::GetDatabase() const
 	return db;
 }
 
+void Service::DataProvider::SetReloadHandler(std::function<void(std::shared_ptr<YGOPro::CardDatabase>)> handler) noexcept
+{
+	onReload = std::move(handler);
+}
+
+void Service::DataProvider::LoadDatabases() noexcept
+{
+	ReloadDatabases();
+}
+
 void Service::DataProvider::OnAdd(const boost::filesystem::path& path, const PathVector& fileList)
 {
 	// Filter and add to set of dbs
@@ -36,17 +49,19 @@ void Service::DataProvider::OnAdd(const boost::filesystem::path& path, const Pat
 			continue;
 		paths.insert((path / fn).lexically_normal());
 	}
-	ReloadDatabases();
 }
 
 void Service::DataProvider::OnDiff(const boost::filesystem::path& path, const GitDiff& diff)
 {
 	// Filter and remove from sets of dbs
+	// NOTE: Modified files are also here, so their cards are read again.
 	for(const auto& fn : diff.removed)
 	{
 		if(!std::regex_match(fn.string(), fnRegex))
 			continue;
-		paths.erase((path / fn).lexically_normal());
+		const auto fullPath = (path / fn).lexically_normal();
+		paths.erase(fullPath);
+		sets.erase(fullPath);
 	}
 	// Filter and add to set of dbs
 	for(const auto& fn : diff.added)
@@ -63,14 +78,57 @@ void Service::DataProvider::OnDiff(const boost::filesystem::path& path, const Gi
 void Service::DataProvider::ReloadDatabases() noexcept
 {
 	auto newDb = std::make_shared<YGOPro::CardDatabase>();
+	const uint64_t key = ImageKey();
+	if(!imagePath.empty() && newDb->LoadImage(imagePath, key))
+	{
+		LOG_INFO(I18N::DATA_PROVIDER_LOADED_IMAGE, imagePath, newDb->Size());
+	}
+	else
+	{
+		// NOTE: Only the files that were not read before (or changed since
+		// then) are read, the rest of the cards are taken from memory.
+		// Databases are merged following the order of their paths.
+		std::vector<YGOPro::CardDatabase::CardSetPtr> toMerge;
+		toMerge.reserve(paths.size());
+		for(const auto& path : paths)
+		{
+			auto& set = sets[path];
+			if(!set)
+			{
+				LOG_INFO(I18N::DATA_PROVIDER_LOADING_ONE, path.string());
+				set = YGOPro::CardDatabase::ReadSet(path.string());
+				if(!set)
+				{
+					LOG_ERROR(I18N::DATA_PROVIDER_COULD_NOT_MERGE);
+					sets.erase(path);
+					continue;
+				}
+			}
+			toMerge.push_back(set);
+		}
+		newDb = std::make_shared<YGOPro::CardDatabase>(toMerge);
+		if(!imagePath.empty() && !newDb->SaveImage(imagePath, key))
+			LOG_ERROR(I18N::DATA_PROVIDER_COULD_NOT_SAVE_IMAGE, imagePath);
+	}
+	{
+		std::scoped_lock lock(mDb);
+		db = newDb;
+	}
+	if(onReload)
+		onReload(std::move(newDb));
+}
+
+uint64_t Service::DataProvider::ImageKey() const noexcept
+{
+	std::size_t key = 0U;
 	for(const auto& path : paths)
 	{
-		LOG_INFO(I18N::DATA_PROVIDER_LOADING_ONE, path.string());
-		if(!newDb->Merge(path.string()))
-			LOG_ERROR(I18N::DATA_PROVIDER_COULD_NOT_MERGE);
+		boost::system::error_code ec;
+		boost::hash_combine(key, path.string());
+		boost::hash_combine(key, boost::filesystem::file_size(path, ec));
+		boost::hash_combine(key, boost::filesystem::last_write_time(path, ec));
 	}
-	std::scoped_lock lock(mDb);
-	db = newDb;
+	return key;
 }
 
 } // namespace Ignis::Multirole
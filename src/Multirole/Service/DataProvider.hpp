@@ -2,19 +2,15 @@
 #define SERVICE_DATAPROVIDER_HPP
 #include "../Service.hpp"
 
+#include <functional>
+#include <map>
 #include <regex>
 #include <memory>
 #include <shared_mutex>
 #include <set>
 
 #include "../IGitRepoObserver.hpp"
-
-namespace YGOPro
-{
-
-class CardDatabase;
-
-} // namespace YGOPro
+#include "../YGOPro/CardDatabase.hpp"
 
 namespace Ignis::Multirole
 {
@@ -22,21 +18,40 @@ namespace Ignis::Multirole
 class Service::DataProvider final : public IGitRepoObserver
 {
 public:
-	DataProvider(Service::LogHandler& lh, std::string_view fnRegexStr);
+	DataProvider(Service::LogHandler& lh, std::string_view fnRegexStr, std::string_view imagePath);
 
 	std::shared_ptr<YGOPro::CardDatabase> GetDatabase() const noexcept;
 
+	// Sets a function called with each newly loaded database once it has
+	// replaced the previous one, from the thread that loaded it. Must be
+	// set before loading any database.
+	void SetReloadHandler(std::function<void(std::shared_ptr<YGOPro::CardDatabase>)> handler) noexcept;
+
+	// Loads the databases of every repository added so far at once. Must
+	// be called after they were all added, so the image on disk is looked
+	// up (and saved) with the key of the whole set of databases.
+	void LoadDatabases() noexcept;
+
 	// IGitRepoObserver overrides
+	// NOTE: OnAdd only registers the databases, see LoadDatabases.
 	void OnAdd(const boost::filesystem::path& path, const PathVector& fileList) override;
 	void OnDiff(const boost::filesystem::path& path, const GitDiff& diff) override;
 private:
 	Service::LogHandler& lh;
 	const std::regex fnRegex;
+	const std::string imagePath;
 	std::set<boost::filesystem::path> paths;
+	// Cards of each database file read so far, reused between reloads.
+	std::map<boost::filesystem::path, YGOPro::CardDatabase::CardSetPtr> sets;
 	std::shared_ptr<YGOPro::CardDatabase> db;
 	mutable std::shared_mutex mDb;
+	std::function<void(std::shared_ptr<YGOPro::CardDatabase>)> onReload;
 
 	void ReloadDatabases() noexcept;
+
+	// Key used to know if the image on disk was built from the current
+	// databases. Changes whenever a database is added, removed or modified.
+	uint64_t ImageKey() const noexcept;
 };
 
 } // namespace Ignis::Multirole
@@ -0,0 +1,116 @@
+#include "DeckCache.hpp"
+
+#include <boost/container_hash/hash.hpp>
+
+namespace Ignis::Multirole
+{
+
+namespace
+{
+
+// NOTE: Databases and banlists are compared by identity (new ones are made
+// whenever they change) through weak pointers, so an address can't be
+// reused by another object while an entry still refers to it.
+template<typename T>
+inline bool Same(const std::weak_ptr<T>& lhs, const std::shared_ptr<T>& rhs) noexcept
+{
+	return !lhs.owner_before(rhs) && !rhs.owner_before(lhs);
+}
+
+inline bool Same(const YGOPro::Deck& lhs, const YGOPro::Deck& rhs) noexcept
+{
+	return lhs.Main() == rhs.Main() && lhs.Extra() == rhs.Extra() &&
+	       lhs.Side() == rhs.Side() && lhs.Error() == rhs.Error();
+}
+
+inline bool Same(const YGOPro::DeckLimits& lhs, const YGOPro::DeckLimits& rhs) noexcept
+{
+	auto SameBoundary = [](const auto& l, const auto& r)
+	{
+		return l.min == r.min && l.max == r.max;
+	};
+	return SameBoundary(lhs.main, rhs.main) &&
+	       SameBoundary(lhs.extra, rhs.extra) &&
+	       SameBoundary(lhs.side, rhs.side);
+}
+
+inline void HashCodes(std::size_t& seed, const YGOPro::CodeVector& codes) noexcept
+{
+	boost::hash_combine(seed, codes.size());
+	boost::hash_range(seed, codes.cbegin(), codes.cend());
+}
+
+} // namespace
+
+// public
+
+Service::DeckCache::DeckCache(std::size_t capacity) :
+	decks(capacity),
+	verdicts(capacity)
+{}
+
+YGOPro::Deck Service::DeckCache::GetDeck(
+	const std::shared_ptr<YGOPro::CardDatabase>& db,
+	const YGOPro::CodeVector& main,
+	const YGOPro::CodeVector& side,
+	const std::function<YGOPro::Deck()>& load)
+{
+	std::size_t hash = 0U;
+	boost::hash_combine(hash, db.get());
+	HashCodes(hash, main);
+	HashCodes(hash, side);
+	{
+		std::scoped_lock lock(mDecks);
+		if(const auto* e = decks.Find(hash);
+		   e != nullptr && Same(e->db, db) && e->main == main && e->side == side)
+			return e->deck;
+	}
+	auto deck = load();
+	std::scoped_lock lock(mDecks);
+	decks.Insert(hash, DeckEntry{db, main, side, deck});
+	return deck;
+}
+
+Service::DeckCache::VerdictPtr Service::DeckCache::GetVerdict(
+	const YGOPro::Deck& deck,
+	const Rules& rules,
+	const std::function<VerdictPtr()>& check)
+{
+	std::size_t hash = 0U;
+	boost::hash_combine(hash, rules.db.get());
+	boost::hash_combine(hash, rules.banlist.get());
+	for(const auto* b : {&rules.limits.main, &rules.limits.extra, &rules.limits.side})
+	{
+		boost::hash_combine(hash, b->min);
+		boost::hash_combine(hash, b->max);
+	}
+	boost::hash_combine(hash, rules.allowed);
+	boost::hash_combine(hash, rules.forb);
+	HashCodes(hash, deck.Main());
+	HashCodes(hash, deck.Extra());
+	HashCodes(hash, deck.Side());
+	boost::hash_combine(hash, deck.Error());
+	{
+		std::scoped_lock lock(mVerdicts);
+		if(const auto* e = verdicts.Find(hash);
+		   e != nullptr && Same(e->db, rules.db) && Same(e->banlist, rules.banlist) &&
+		   Same(e->limits, rules.limits) && e->allowed == rules.allowed &&
+		   e->forb == rules.forb && Same(e->deck, deck))
+			return e->verdict;
+	}
+	auto verdict = check();
+	std::scoped_lock lock(mVerdicts);
+	verdicts.Insert(hash, VerdictEntry
+	{
+		rules.db,
+		rules.banlist,
+		rules.limits,
+		rules.allowed,
+		rules.forb,
+		deck,
+		verdict
+	});
+	return verdict;
+}
+
+} // namespace Ignis::Multirole
@@ -0,0 +1,136 @@
+#ifndef SERVICE_DECKCACHE_HPP
+#define SERVICE_DECKCACHE_HPP
+#include "../Service.hpp"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "../YGOPro/Deck.hpp"
+
+namespace YGOPro
+{
+
+class Banlist;
+class CardDatabase;
+class STOCMsg;
+
+} // namespace YGOPro
+
+namespace Ignis::Multirole
+{
+
+// Remembers the decks made out of the codes sent by clients as well as the
+// result of validating them, as the same decks are sent over and over again
+// (on each deck update, rematch or room). Both are least recently used
+// caches shared by all rooms, keyed by everything the results depend on.
+class Service::DeckCache final
+{
+public:
+	using VerdictPtr = std::shared_ptr<const YGOPro::STOCMsg>; // nullptr if valid.
+
+	struct Rules
+	{
+		std::shared_ptr<YGOPro::CardDatabase> db;
+		std::shared_ptr<YGOPro::Banlist> banlist;
+		YGOPro::DeckLimits limits;
+		uint8_t allowed;
+		int32_t forb;
+	};
+
+	// Capacity is the maximum number of decks and verdicts to remember,
+	// zero disables the cache.
+	DeckCache(std::size_t capacity);
+
+	// Returns the deck for the given codes and database, calling load to
+	// make it if not cached.
+	YGOPro::Deck GetDeck(
+		const std::shared_ptr<YGOPro::CardDatabase>& db,
+		const YGOPro::CodeVector& main,
+		const YGOPro::CodeVector& side,
+		const std::function<YGOPro::Deck()>& load);
+
+	// Returns the result of validating the deck under the given rules,
+	// calling check to get it if not cached.
+	VerdictPtr GetVerdict(
+		const YGOPro::Deck& deck,
+		const Rules& rules,
+		const std::function<VerdictPtr()>& check);
+private:
+	// NOTE: Entries are found through a hash of their key, which is also
+	// stored in the entry to tell collisions apart.
+	template<typename Entry>
+	class Lru
+	{
+	public:
+		Lru(std::size_t capacity) : capacity(capacity)
+		{}
+
+		// Entry with the given hash, now the most recently used one.
+		Entry* Find(uint64_t hash)
+		{
+			auto search = index.find(hash);
+			if(search == index.end())
+				return nullptr;
+			items.splice(items.begin(), items, search->second);
+			return &search->second->second;
+		}
+
+		// Adds (or replaces) an entry, evicting the least recently used one
+		// if full.
+		void Insert(uint64_t hash, Entry&& entry)
+		{
+			if(capacity == 0U)
+				return;
+			if(auto search = index.find(hash); search != index.end())
+			{
+				items.erase(search->second);
+				index.erase(search);
+			}
+			else if(index.size() >= capacity)
+			{
+				index.erase(items.back().first);
+				items.pop_back();
+			}
+			items.emplace_front(hash, std::move(entry));
+			index.emplace(hash, items.begin());
+		}
+	private:
+		using List = std::list<std::pair<uint64_t, Entry>>;
+
+		const std::size_t capacity;
+		List items; // Most recently used first.
+		std::unordered_map<uint64_t, typename List::iterator> index;
+	};
+
+	struct DeckEntry
+	{
+		std::weak_ptr<YGOPro::CardDatabase> db;
+		YGOPro::CodeVector main;
+		YGOPro::CodeVector side;
+		YGOPro::Deck deck;
+	};
+
+	struct VerdictEntry
+	{
+		std::weak_ptr<YGOPro::CardDatabase> db;
+		std::weak_ptr<YGOPro::Banlist> banlist;
+		YGOPro::DeckLimits limits;
+		uint8_t allowed;
+		int32_t forb;
+		YGOPro::Deck deck;
+		VerdictPtr verdict;
+	};
+
+	Lru<DeckEntry> decks;
+	std::mutex mDecks;
+	Lru<VerdictEntry> verdicts;
+	std::mutex mVerdicts;
+};
+
+} // namespace Ignis::Multirole
+
+#endif // SERVICE_DECKCACHE_HPP
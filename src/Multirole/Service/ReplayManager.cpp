@@ -1,5 +1,15 @@
 #include "ReplayManager.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h> // open
+#include <unistd.h> // close, fsync
+#endif // _WIN32
+
+#include <boost/asio/post.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
@@ -9,7 +19,6 @@
 #define LOG_WARN(...) lh.Log(ServiceType::REPLAY_MANAGER, Level::WARN, __VA_ARGS__)
 #define LOG_ERROR(...) lh.Log(ServiceType::REPLAY_MANAGER, Level::ERROR, __VA_ARGS__)
 #include "../I18N.hpp"
-#include "../YGOPro/Replay.hpp"
 
 namespace Ignis::Multirole
 {
@@ -21,14 +30,50 @@ constexpr auto IOS_BINARY = std::ios_base::binary;
 constexpr auto IOS_BINARY_IN = IOS_BINARY | std::ios_base::in;
 constexpr auto IOS_BINARY_OUT = IOS_BINARY | std::ios_base::out;
 
+inline bool SameCompression(
+	const YGOPro::Replay::Compression& lhs,
+	const YGOPro::Replay::Compression& rhs) noexcept
+{
+	return lhs.level == rhs.level && lhs.dictSize == rhs.dictSize &&
+		lhs.fastModeThreshold == rhs.fastModeThreshold &&
+		lhs.multiThreadThreshold == rhs.multiThreadThreshold;
+}
+
+// The saving settings are assumed to never make a replay compressed with
+// the fast mode of the sending settings more than 1/this smaller. Level 9
+// was measured to be 7-10% smaller than level 1 on replay-like data, so
+// only replays up to ~1.1 times the size limit are compressed again.
+constexpr std::size_t MAX_SAVE_COMPRESSION_GAIN = 10U;
+
 } // namespace
 
-Service::ReplayManager::ReplayManager(Service::LogHandler& lh, bool save, const boost::filesystem::path& dir) :
+// public
+
+Service::ReplayManager::ReplayManager(
+	Service::LogHandler& lh,
+	bool save,
+	const boost::filesystem::path& dir,
+	uint64_t idLeaseSize,
+	std::size_t maxQueuedBytes,
+	uint64_t segmentSize,
+	std::chrono::seconds segmentLifetime,
+	const YGOPro::Replay::Compression& sendCompression,
+	const YGOPro::Replay::Compression& saveCompression)
+	:
 	lh(lh),
 	save(save),
 	dir(dir),
 	lastId(dir / "lastId"),
-	mLastId()
+	idLeaseSize(std::max<uint64_t>(idLeaseSize, 1U)),
+	nextId(0U),
+	leaseEnd(0U),
+	mLastId(),
+	sendCompression(sendCompression),
+	saveCompression(saveCompression),
+	serializers(std::max(1U, std::thread::hardware_concurrency() / 2U)),
+	maxQueuedBytes(maxQueuedBytes),
+	queuedBytes(0U),
+	stopping(false)
 {
 	if(!save)
 	{
@@ -48,70 +93,266 @@ Service::ReplayManager::ReplayManager(Service::LogHandler& lh, bool save, const
 			throw std::runtime_error(I18N::REPLAY_MANAGER_ERROR_WRITING_INITIAL_ID);
 		f.write(reinterpret_cast<char*>(&id), sizeof(id));
 	}
-	lLastId = boost::interprocess::file_lock(lastId.string().data());
+	// NOTE: The lock is on a file of its own, as lastId is replaced
+	// (rather than modified) by each write.
+	const auto lockPath = path(lastId).concat(".lock");
+	if(!exists(lockPath))
+	{
+		std::fstream f(lockPath, IOS_BINARY_OUT);
+		if(!f.is_open())
+			throw std::runtime_error(I18N::REPLAY_MANAGER_ERROR_WRITING_INITIAL_ID);
+	}
+	lLastId = boost::interprocess::file_lock(lockPath.string().data());
+	{
+		boost::interprocess::scoped_lock<boost::interprocess::file_lock> plock(lLastId);
+		if(std::fstream f(lastId, IOS_BINARY_IN); f.is_open())
+		{
+			f.ignore(std::numeric_limits<std::streamsize>::max());
+			std::streamsize fsize = f.gcount();
+			f.clear();
+			if(fsize == sizeof(id))
+			{
+				f.seekg(0, std::ios_base::beg);
+				f.read(reinterpret_cast<char*>(&id), sizeof(id));
+				LOG_INFO(I18N::REPLAY_MANAGER_CURRENT_ID, id);
+			}
+			else
+			{
+				LOG_WARN(I18N::REPLAY_MANAGER_LASTID_SIZE_CORRUPTED, fsize, sizeof(id));
+			}
+		}
+	}
+	if(segmentSize != 0U)
+		archive.emplace(dir, segmentSize, segmentLifetime);
+	writer = std::thread([this](){DoWrite();});
+}
+
+Service::ReplayManager::~ReplayManager() noexcept
+{
+	// NOTE: Replays being sent can still queue replays to save.
+	serializers.join();
+	if(writer.joinable())
+	{
+		{
+			std::scoped_lock lock(mQueue);
+			stopping = true;
+		}
+		cvQueue.notify_one();
+		writer.join();
+	}
+	if(!save || nextId == leaseEnd)
+		return;
+	// Unused ids can only be given back if nobody else leased after us.
+	std::scoped_lock tlock(mLastId);
 	boost::interprocess::scoped_lock<boost::interprocess::file_lock> plock(lLastId);
-	if(std::fstream f(lastId, IOS_BINARY_IN); f.is_open())
+	if(uint64_t id = 0U; ReadLastId(id) && id == leaseEnd)
+		WriteLastId(nextId);
+}
+
+void Service::ReplayManager::AsyncSerialize(
+	uint64_t id,
+	std::shared_ptr<const YGOPro::Replay> replay,
+	std::size_t maxSize,
+	std::function<void(std::vector<uint8_t>)> handler) noexcept
+{
+	boost::asio::post(serializers,
+	[this, id, replay = std::move(replay), maxSize, handler = std::move(handler)]() mutable
+	{
+		std::vector<uint8_t> saved;
+		auto bytes = Serialize(*replay, maxSize, saved);
+		// NOTE: Saving can block if the writing queue is full, better here
+		// than on the caller's strand.
+		Save(id, std::move(replay), std::move(saved));
+		handler(std::move(bytes));
+	});
+}
+
+uint64_t Service::ReplayManager::NewId() noexcept
+{
+	if(!save)
+		return 0U;
+	std::scoped_lock tlock(mLastId);
+	if(nextId == leaseEnd && !Lease())
+		return 0U;
+	return nextId++;
+}
+
+// private
+
+std::vector<uint8_t> Service::ReplayManager::Serialize(
+	const YGOPro::Replay& replay,
+	std::size_t maxSize,
+	std::vector<uint8_t>& saved) const noexcept
+{
+	auto bytes = replay.Serialize(sendCompression);
+	if(SameCompression(sendCompression, saveCompression))
+	{
+		saved = bytes;
+		return bytes;
+	}
+	// NOTE: Without the fast mode the saving settings barely make the
+	// replay any smaller, so it is only tried when it likely makes it fit.
+	if(bytes.size() > maxSize && replay.UsesFastMode(sendCompression) &&
+	   !replay.UsesFastMode(saveCompression) &&
+	   bytes.size() - bytes.size() / MAX_SAVE_COMPRESSION_GAIN <= maxSize)
+	{
+		saved = replay.Serialize(saveCompression);
+		if(saved.size() < bytes.size())
+			bytes = saved;
+	}
+	return bytes;
+}
+
+void Service::ReplayManager::Save(
+	uint64_t id,
+	std::shared_ptr<const YGOPro::Replay> replay,
+	std::vector<uint8_t> saved) noexcept
+{
+	if(!save)
+		return;
+	QueuedReplay qr{id, {}, {}, 0U};
+	if(!saved.empty())
 	{
-		f.ignore(std::numeric_limits<std::streamsize>::max());
-		std::streamsize fsize = f.gcount();
-		f.clear();
-		if(fsize == sizeof(id))
+		qr.size = saved.size();
+		qr.bytes = std::move(saved);
+	}
+	else
+	{
+		qr.size = replay->RecordedSize();
+		qr.replay = std::move(replay);
+	}
+	{
+		std::scoped_lock lock(mQueue);
+		if(queuedBytes + qr.size <= maxQueuedBytes)
 		{
-			f.seekg(0, std::ios_base::beg);
-			f.read(reinterpret_cast<char*>(&id), sizeof(id));
-			LOG_INFO(I18N::REPLAY_MANAGER_CURRENT_ID, id);
+			queuedBytes += qr.size;
+			queue.push_back(std::move(qr));
+			cvQueue.notify_one();
 			return;
 		}
-		LOG_WARN(I18N::REPLAY_MANAGER_LASTID_SIZE_CORRUPTED, fsize, sizeof(id));
 	}
+	LOG_WARN(I18N::REPLAY_MANAGER_QUEUE_FULL, id);
+	Write(qr);
 }
 
-void Service::ReplayManager::Save(uint64_t id, const YGOPro::Replay& replay) const noexcept
+void Service::ReplayManager::DoWrite() noexcept
 {
-	if(!save)
+	std::unique_lock lock(mQueue);
+	for(;;)
+	{
+		cvQueue.wait(lock, [&](){return stopping || !queue.empty();});
+		if(queue.empty())
+			return;
+		// NOTE: Released (but still counted) while writing.
+		std::deque<QueuedReplay> batch;
+		std::swap(batch, queue);
+		lock.unlock();
+		std::size_t written = 0U;
+		for(const auto& qr : batch)
+		{
+			Write(qr);
+			written += qr.size;
+		}
+		batch.clear();
+		lock.lock();
+		queuedBytes -= written;
+	}
+}
+
+void Service::ReplayManager::Write(const QueuedReplay& qr) noexcept
+{
+	if(qr.replay)
+		Write(qr.id, qr.replay->Serialize(saveCompression));
+	else
+		Write(qr.id, qr.bytes);
+}
+
+void Service::ReplayManager::Write(uint64_t id, const std::vector<uint8_t>& bytes) noexcept
+{
+	if(archive)
+	{
+		// NOTE: Also written from rooms when the queue is full.
+		std::scoped_lock lock(mArchive);
+		if(!archive->Append(id, bytes))
+			LOG_ERROR(I18N::REPLAY_MANAGER_UNABLE_TO_SAVE, id);
 		return;
+	}
 	const auto fn = dir / (std::to_string(id) + ".yrpX");
-	const auto& bytes = replay.Bytes();
 	if(std::fstream f(fn, IOS_BINARY_OUT); f.is_open())
 		f.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 	else
 		LOG_ERROR(I18N::REPLAY_MANAGER_UNABLE_TO_SAVE, fn.string());
 }
 
-uint64_t Service::ReplayManager::NewId() noexcept
+bool Service::ReplayManager::Lease() noexcept
 {
-	if(!save)
-		return 0U;
-	uint64_t prevId = 0U;
 	uint64_t id = 0U;
-	std::scoped_lock tlock(mLastId);
 	boost::interprocess::scoped_lock<boost::interprocess::file_lock> plock(lLastId);
-	if(std::fstream f(lastId, IOS_BINARY_IN); f.is_open())
+	if(!ReadLastId(id))
+		return false;
+	if(!WriteLastId(id + idLeaseSize))
 	{
-		f.ignore(std::numeric_limits<std::streamsize>::max());
-		std::streamsize fsize = f.gcount();
-		f.clear();
-		if(fsize != sizeof(id))
-		{
-			LOG_ERROR(I18N::REPLAY_MANAGER_LASTID_SIZE_CORRUPTED, fsize, sizeof(id));
-			return 0U;
-		}
-		f.seekg(0, std::ios_base::beg);
-		f.read(reinterpret_cast<char*>(&id), sizeof(id));
+		LOG_ERROR(I18N::REPLAY_MANAGER_CANNOT_WRITE_ID);
+		return false;
 	}
-	else
+	nextId = id;
+	leaseEnd = id + idLeaseSize;
+	return true;
+}
+
+bool Service::ReplayManager::ReadLastId(uint64_t& id) const noexcept
+{
+	std::fstream f(lastId, IOS_BINARY_IN);
+	if(!f.is_open())
 	{
 		LOG_ERROR(I18N::REPLAY_MANAGER_CANNOT_OPEN_LASTID);
-		return 0U;
+		return false;
 	}
-	prevId = id++;
-	if(std::fstream f(lastId, IOS_BINARY_OUT); f.is_open())
+	f.ignore(std::numeric_limits<std::streamsize>::max());
+	std::streamsize fsize = f.gcount();
+	f.clear();
+	if(fsize != sizeof(id))
 	{
-		f.write(reinterpret_cast<char*>(&id), sizeof(id));
-		return prevId;
+		LOG_ERROR(I18N::REPLAY_MANAGER_LASTID_SIZE_CORRUPTED, fsize, sizeof(id));
+		return false;
+	}
+	f.seekg(0, std::ios_base::beg);
+	f.read(reinterpret_cast<char*>(&id), sizeof(id));
+	return true;
+}
+
+bool Service::ReplayManager::WriteLastId(uint64_t id) const noexcept
+{
+	// NOTE: Written to a temporary file, flushed all the way to disk, that
+	// then replaces the old one. Otherwise a crash could lose the lease or
+	// leave the file empty, making the next instance hand out the same ids
+	// again.
+	const auto tmp = boost::filesystem::path(lastId).concat(".tmp");
+	std::FILE* f = std::fopen(tmp.string().data(), "wb");
+	if(f == nullptr)
+		return false;
+	bool ok = std::fwrite(&id, sizeof(id), 1U, f) == 1U && std::fflush(f) == 0;
+#ifndef _WIN32
+	ok = ok && fsync(fileno(f)) == 0;
+#endif // _WIN32
+	ok = (std::fclose(f) == 0) && ok;
+	boost::system::error_code ec;
+	if(ok)
+		boost::filesystem::rename(tmp, lastId, ec);
+	if(!ok || ec)
+	{
+		boost::filesystem::remove(tmp, ec);
+		return false;
+	}
+#ifndef _WIN32
+	// The rename itself must reach the disk as well.
+	if(int fd = open(dir.string().data(), O_RDONLY); fd != -1)
+	{
+		ok = fsync(fd) == 0;
+		close(fd);
 	}
-	LOG_ERROR(I18N::REPLAY_MANAGER_CANNOT_WRITE_ID);
-	return 0U;
+#endif // _WIN32
+	return ok;
 }
 
 } // namespace Ignis::Multirole
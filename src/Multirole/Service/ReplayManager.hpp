@@ -2,19 +2,23 @@
 #define SERVICE_REPLAYMANAGER_HPP
 #include "../Service.hpp"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
+#include <boost/asio/thread_pool.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
-namespace YGOPro
-{
-
-class Replay;
-
-} // namespace YGOPro
+#include "../ReplayArchive.hpp"
+#include "../YGOPro/Replay.hpp"
 
 namespace Ignis::Multirole
 {
@@ -22,9 +26,39 @@ namespace Ignis::Multirole
 class Service::ReplayManager
 {
 public:
-	ReplayManager(Service::LogHandler& lh, bool save, const boost::filesystem::path& dir);
+	// Ids are leased from the lastId file in blocks of idLeaseSize, so
+	// the file is only touched once per block. Replays are written to disk
+	// from a thread of its own, holding up to maxQueuedBytes of them.
+	// If segmentSize is not 0, replays are appended to a ReplayArchive on
+	// the directory, otherwise each one is written to a file of its own.
+	// Replays sent to clients are compressed with sendCompression, the ones
+	// saved with saveCompression. Replays to send are compressed on a pool
+	// of threads of their own, as doing so can take seconds.
+	ReplayManager(
+		Service::LogHandler& lh,
+		bool save,
+		const boost::filesystem::path& dir,
+		uint64_t idLeaseSize,
+		std::size_t maxQueuedBytes,
+		uint64_t segmentSize,
+		std::chrono::seconds segmentLifetime,
+		const YGOPro::Replay::Compression& sendCompression,
+		const YGOPro::Replay::Compression& saveCompression);
+
+	// Writes the replays still queued and gives back the ids left from the
+	// current lease, if possible.
+	~ReplayManager() noexcept;
 
-	void Save(uint64_t id, const YGOPro::Replay& replay) const noexcept;
+	// Compresses the replay to send to clients on the serializing threads,
+	// saves it with the given id and then calls `handler` from there with
+	// the result. Should it not fit in maxSize after using the fast mode of
+	// the sending settings, it is compressed again with the saving settings
+	// if that is likely to make it fit, the result is then saved as is.
+	void AsyncSerialize(
+		uint64_t id,
+		std::shared_ptr<const YGOPro::Replay> replay,
+		std::size_t maxSize,
+		std::function<void(std::vector<uint8_t>)> handler) noexcept;
 
 	uint64_t NewId() noexcept;
 private:
@@ -32,8 +66,65 @@ private:
 	const bool save;
 	const boost::filesystem::path dir;
 	const boost::filesystem::path lastId;
+	const uint64_t idLeaseSize;
+	uint64_t nextId; // Next id to hand out from the current lease.
+	uint64_t leaseEnd; // One past the last id of the current lease.
 	std::mutex mLastId; // guarantees thread-safety
-	boost::interprocess::file_lock lLastId; // guarantees process-safety
+	boost::interprocess::file_lock lLastId; // guarantees process-safety (on lastId.lock)
+
+	const YGOPro::Replay::Compression sendCompression;
+	const YGOPro::Replay::Compression saveCompression;
+	boost::asio::thread_pool serializers;
+
+	struct QueuedReplay
+	{
+		uint64_t id;
+		std::shared_ptr<const YGOPro::Replay> replay; // Still to compress.
+		std::vector<uint8_t> bytes; // Already compressed.
+		std::size_t size; // Counted towards maxQueuedBytes.
+	};
+
+	const std::size_t maxQueuedBytes;
+	std::deque<QueuedReplay> queue;
+	std::size_t queuedBytes;
+	bool stopping;
+	std::mutex mQueue;
+	std::condition_variable cvQueue;
+	std::thread writer;
+
+	std::optional<ReplayArchive> archive;
+	std::mutex mArchive;
+
+	// Returns the replay to send to clients, see AsyncSerialize. `saved`
+	// is set to the replay compressed with the saving settings, if that
+	// was done along the way.
+	std::vector<uint8_t> Serialize(
+		const YGOPro::Replay& replay,
+		std::size_t maxSize,
+		std::vector<uint8_t>& saved) const noexcept;
+
+	// Queues the replay to be compressed and written, `saved` is written
+	// instead if not empty. If the queue is full (the disk can't keep up)
+	// the replay is written right away instead, slowing down the caller
+	// rather than using more memory.
+	void Save(
+		uint64_t id,
+		std::shared_ptr<const YGOPro::Replay> replay,
+		std::vector<uint8_t> saved) noexcept;
+
+	// Writes all the replays queued so far at once, until stopped.
+	void DoWrite() noexcept;
+
+	void Write(const QueuedReplay& qr) noexcept;
+	void Write(uint64_t id, const std::vector<uint8_t>& bytes) noexcept;
+
+	// Reserves the next block of ids by advancing the id stored on file.
+	// NOTE: mLastId must be locked.
+	bool Lease() noexcept;
+
+	// NOTE: lLastId must be locked.
+	bool ReadLastId(uint64_t& id) const noexcept;
+	bool WriteLastId(uint64_t id) const noexcept;
 };
 
 } // namespace Ignis::Multirole
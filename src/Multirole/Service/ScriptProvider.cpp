@@ -1,8 +1,18 @@
 #include "ScriptProvider.hpp"
 
+#include <algorithm>
 #include <stdexcept> // std::runtime_error
 #include <fstream>
-#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#ifdef MULTIROLE_LUA_BYTECODE
+#include <lua.hpp>
+#endif // MULTIROLE_LUA_BYTECODE
 
 #include "LogHandler.hpp"
 #define LOG_INFO(...) lh.Log(ServiceType::SCRIPT_PROVIDER, Level::INFO, __VA_ARGS__)
@@ -12,12 +22,60 @@
 namespace Ignis::Multirole
 {
 
+#ifdef MULTIROLE_LUA_BYTECODE
+namespace
+{
+
+int BytecodeWriter(lua_State* /*L*/, const void* p, std::size_t sz, void* ud)
+{
+	static_cast<std::string*>(ud)->append(static_cast<const char*>(p), sz);
+	return 0;
+}
+
+struct LuaStateDeleter
+{
+	void operator()(lua_State* L) const noexcept
+	{
+		lua_close(L);
+	}
+};
+
+} // namespace
+#endif // MULTIROLE_LUA_BYTECODE
+
+namespace
+{
+
+Core::IScriptSupplier::Script MakeProbe([[maybe_unused]] bool precompile)
+{
+	auto probe = std::make_shared<std::string>();
+#ifdef MULTIROLE_LUA_BYTECODE
+	if(precompile)
+	{
+		std::unique_ptr<lua_State, LuaStateDeleter> L(luaL_newstate());
+		if(luaL_loadbufferx(L.get(), "", 0U, "probe", "t") == LUA_OK)
+			lua_dump(L.get(), &BytecodeWriter, probe.get(), 0);
+	}
+#endif // MULTIROLE_LUA_BYTECODE
+	return probe;
+}
+
+} // namespace
+
 // public
 
-Service::ScriptProvider::ScriptProvider(Service::LogHandler& lh, std::string_view fnRegexStr) :
+Service::ScriptProvider::ScriptProvider(Service::LogHandler& lh, std::string_view fnRegexStr, bool precompile) :
 	lh(lh),
-	fnRegex(fnRegexStr.data())
-{}
+	fnRegex(fnRegexStr.data()),
+	precompile(precompile),
+	probe(MakeProbe(precompile)),
+	scripts(std::make_shared<ScriptMap>())
+{
+#ifndef MULTIROLE_LUA_BYTECODE
+	if(precompile)
+		throw std::runtime_error(I18N::SCRIPT_PROVIDER_NO_BYTECODE_SUPPORT);
+#endif // MULTIROLE_LUA_BYTECODE
+}
 
 void Service::ScriptProvider::OnAdd(const boost::filesystem::path& path, const PathVector& fileList)
 {
@@ -29,40 +87,122 @@ void Service::ScriptProvider::OnDiff(const boost::filesystem::path& path, const
 	LoadScripts(path, diff.added);
 }
 
-std::string Service::ScriptProvider::ScriptFromFilePath(std::string_view fp) const noexcept
+Service::ScriptProvider::Script Service::ScriptProvider::ScriptFromFilePath(std::string_view fp) const noexcept
 {
+	static const auto EMPTY = std::make_shared<const std::string>();
 	std::shared_lock lock(mScripts);
-	if(auto search = scripts.find(fp.data()); search != scripts.end())
-		return search->second;
-	return std::string();
+	if(auto search = scripts->find(fp); search != scripts->end())
+		return Script(search->second, &search->second->contents);
+	return EMPTY;
+}
+
+Service::ScriptProvider::Script Service::ScriptProvider::BytecodeFromFilePath(std::string_view fp) const noexcept
+{
+	static const auto EMPTY = std::make_shared<const std::string>();
+	std::shared_lock lock(mScripts);
+	if(auto search = scripts->find(fp); search != scripts->end())
+		return Script(search->second, &search->second->bytecode);
+	return EMPTY;
+}
+
+Service::ScriptProvider::Script Service::ScriptProvider::BytecodeProbe() const noexcept
+{
+	return probe;
 }
 
 // private
 
 void Service::ScriptProvider::LoadScripts(const boost::filesystem::path& path, const PathVector& fileList) noexcept
 {
-	int total = 0;
 	LOG_INFO(I18N::SCRIPT_PROVIDER_LOADING_FILES, fileList.size());
-	std::scoped_lock lock(mScripts);
+	PathVector files;
 	for(const auto& fn : fileList)
+		if(std::regex_match(fn.string(), fnRegex))
+			files.emplace_back(fn);
+	// Read the files without holding the lock, so rooms can keep on
+	// getting scripts meanwhile. Spread over several threads, each one
+	// taking every Nth file, as there can be thousands of them.
+	std::vector<std::shared_ptr<const ScriptFile>> loaded(files.size());
+	const auto threadCount = static_cast<unsigned int>(std::min<std::size_t>(
+		std::max(1U, std::thread::hardware_concurrency()), files.size()));
+	boost::asio::thread_pool pool(std::max(1U, threadCount));
+	for(unsigned int t = 0U; t < threadCount; t++)
 	{
-		if(!std::regex_match(fn.string(), fnRegex))
-			continue;
-		const auto fullPath = (path / fn).lexically_normal();
-		// Open file, checking if it exists
-		std::ifstream file(fullPath, std::ifstream::binary);
-		if(!file.is_open())
+		boost::asio::post(pool, [&, t]()
 		{
-			LOG_ERROR(I18N::SCRIPT_PROVIDER_COULD_NOT_OPEN, fullPath.string());
-			continue;
-		}
-		// Read actual file into memory and place into script map
-		std::stringstream buffer;
-		buffer << file.rdbuf();
-		scripts.insert_or_assign(fn.filename().string(), buffer.str());
-		total++;
+#ifdef MULTIROLE_LUA_BYTECODE
+			// NOTE: Chunks are only compiled, never run, so a single bare
+			// state per thread is enough for all of them.
+			std::unique_ptr<lua_State, LuaStateDeleter> L(precompile ? luaL_newstate() : nullptr);
+#endif // MULTIROLE_LUA_BYTECODE
+			for(std::size_t i = t; i < files.size(); i += threadCount)
+			{
+#ifdef MULTIROLE_LUA_BYTECODE
+				loaded[i] = LoadScript(path, files[i], L.get());
+#else
+				loaded[i] = LoadScript(path, files[i], nullptr);
+#endif // MULTIROLE_LUA_BYTECODE
+			}
+		});
+	}
+	pool.join();
+	loaded.erase(std::remove(loaded.begin(), loaded.end(), nullptr), loaded.end());
+	// Make the new map, only the scripts that were loaded are replaced.
+	auto newScripts = [&]()
+	{
+		std::shared_lock lock(mScripts);
+		return std::make_shared<ScriptMap>(*scripts);
+	}();
+	for(auto& sf : loaded)
+	{
+		// NOTE: Erasing first as assigning would keep the old key, which
+		// points to the name of the script being replaced.
+		const std::string_view name = sf->name;
+		newScripts->erase(name);
+		newScripts->emplace(name, std::move(sf));
+	}
+	{
+		std::scoped_lock lock(mScripts);
+		scripts = std::move(newScripts);
+	}
+	LOG_INFO(I18N::SCRIPT_PROVIDER_TOTAL_FILES_LOADED, loaded.size());
+}
+
+std::shared_ptr<const Service::ScriptProvider::ScriptFile> Service::ScriptProvider::LoadScript(
+	const boost::filesystem::path& path,
+	const boost::filesystem::path& fn,
+	[[maybe_unused]] lua_State* L) const noexcept
+{
+	const auto fullPath = (path / fn).lexically_normal();
+	// Open file, checking if it exists
+	std::ifstream file(fullPath, std::ifstream::binary);
+	boost::system::error_code ec;
+	const auto size = boost::filesystem::file_size(fullPath, ec);
+	if(!file.is_open() || ec)
+	{
+		LOG_ERROR(I18N::SCRIPT_PROVIDER_COULD_NOT_OPEN, fullPath.string());
+		return nullptr;
+	}
+	// Read actual file straight into its final buffer
+	ScriptFile sf{fn.filename().string(), std::string(size, '\0'), {}};
+	if(!file.read(sf.contents.data(), static_cast<std::streamsize>(size)))
+	{
+		LOG_ERROR(I18N::SCRIPT_PROVIDER_COULD_NOT_OPEN, fullPath.string());
+		return nullptr;
+	}
+#ifdef MULTIROLE_LUA_BYTECODE
+	// Chunk is named the same way the core names the scripts it loads,
+	// if it fails to compile the core gets the source and reports it.
+	if(L != nullptr)
+	{
+		if(luaL_loadbufferx(L, sf.contents.data(), sf.contents.size(), sf.name.data(), "t") == LUA_OK)
+			lua_dump(L, &BytecodeWriter, &sf.bytecode, 0);
+		else
+			LOG_ERROR(I18N::SCRIPT_PROVIDER_COULD_NOT_COMPILE, fullPath.string(), lua_tostring(L, -1));
+		lua_settop(L, 0);
 	}
-	LOG_INFO(I18N::SCRIPT_PROVIDER_TOTAL_FILES_LOADED, total);
+#endif // MULTIROLE_LUA_BYTECODE
+	return std::make_shared<const ScriptFile>(std::move(sf));
 }
 
 } // namespace Ignis::Multirole
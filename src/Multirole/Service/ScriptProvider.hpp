@@ -2,6 +2,7 @@
 #define SERVICE_SCRIPTPROVIDER_HPP
 #include "../Service.hpp"
 
+#include <memory>
 #include <regex>
 #include <unordered_map>
 #include <shared_mutex>
@@ -9,27 +10,54 @@
 #include "../IGitRepoObserver.hpp"
 #include "../Core/IScriptSupplier.hpp"
 
+struct lua_State;
+
 namespace Ignis::Multirole
 {
 
 class Service::ScriptProvider final : public IGitRepoObserver, public Core::IScriptSupplier
 {
 public:
-	ScriptProvider(Service::LogHandler& lh, std::string_view fnRegexStr);
+	// If precompile is set, scripts are also compiled to Lua bytecode when
+	// loaded, throws if Lua support was not built in.
+	ScriptProvider(Service::LogHandler& lh, std::string_view fnRegexStr, bool precompile);
 
 	// IGitRepoObserver overrides
 	void OnAdd(const boost::filesystem::path& path, const PathVector& fileList) override;
 	void OnDiff(const boost::filesystem::path& path, const GitDiff& diff) override;
 
 	// Core::IScriptSupplier overrides
-	std::string ScriptFromFilePath(std::string_view fp) const noexcept override;
+	Script ScriptFromFilePath(std::string_view fp) const noexcept override;
+	Script BytecodeFromFilePath(std::string_view fp) const noexcept override;
+	Script BytecodeProbe() const noexcept override;
 private:
+	struct ScriptFile
+	{
+		std::string name;
+		std::string contents;
+		std::string bytecode; // NOTE: Empty if not precompiled.
+	};
+
+	// NOTE: Keys point to the name of their respective ScriptFile.
+	using ScriptMap = std::unordered_map<std::string_view, std::shared_ptr<const ScriptFile>>;
+
 	Service::LogHandler& lh;
 	const std::regex fnRegex;
-	std::unordered_map<std::string, std::string> scripts;
+	const bool precompile;
+	const Script probe;
+	// Replaced as a whole by each load, sharing unchanged scripts with the
+	// previous map.
+	std::shared_ptr<const ScriptMap> scripts;
 	mutable std::shared_mutex mScripts;
 
 	void LoadScripts(const boost::filesystem::path& path, const PathVector& fileList) noexcept;
+
+	// Reads a single script, also compiling it if given a Lua state.
+	// Returns nullptr if the file couldn't be read.
+	std::shared_ptr<const ScriptFile> LoadScript(
+		const boost::filesystem::path& path,
+		const boost::filesystem::path& fn,
+		lua_State* L) const noexcept;
 };
 
 } // namespace Ignis::Multirole
@@ -0,0 +1,90 @@
+#include "TimerWheel.hpp"
+
+#include <algorithm>
+
+namespace Ignis::Multirole
+{
+
+// public
+
+TimerWheel::TimerWheel(boost::asio::io_context& ioCtx) :
+	timer(ioCtx),
+	now(0U),
+	stopped(false)
+{
+	timer.expires_after(std::chrono::seconds(1));
+	DoTick();
+}
+
+uint64_t TimerWheel::Now() const noexcept
+{
+	return now.load(std::memory_order_relaxed);
+}
+
+void TimerWheel::Schedule(std::weak_ptr<IEntry> entry, unsigned int seconds)
+{
+	std::scoped_lock lock(mLevels);
+	const uint64_t delay = std::clamp<uint64_t>(seconds, 1U, MAX_DELAY);
+	Insert({std::move(entry), now.load(std::memory_order_relaxed) + delay});
+}
+
+void TimerWheel::Stop() noexcept
+{
+	std::scoped_lock lock(mLevels);
+	stopped = true;
+	timer.cancel();
+}
+
+// private
+
+void TimerWheel::DoTick()
+{
+	timer.async_wait([this](const boost::system::error_code& ec)
+	{
+		if(ec)
+			return;
+		Slot expired;
+		{
+			std::scoped_lock lock(mLevels);
+			const uint64_t tick = now.load(std::memory_order_relaxed) + 1U;
+			now.store(tick, std::memory_order_relaxed);
+			// Higher levels are brought down whenever the lower level wraps.
+			for(std::size_t level = LEVEL_COUNT - 1U; level > 0U; level--)
+				if((tick & ((uint64_t{1U} << (SLOT_BITS * level)) - 1U)) == 0U)
+					Cascade(level);
+			std::swap(expired, levels[0U][tick & (SLOT_COUNT - 1U)]);
+		}
+		// NOTE: Called without the lock held so entries can reschedule.
+		for(auto& item : expired)
+			if(auto entry = item.entry.lock(); entry)
+				entry->OnTimeout();
+		std::scoped_lock lock(mLevels);
+		if(stopped)
+			return;
+		// NOTE: Relative to previous expiry so the wheel doesn't drift.
+		timer.expires_at(timer.expiry() + std::chrono::seconds(1));
+		DoTick();
+	});
+}
+
+void TimerWheel::Insert(Item&& item)
+{
+	const uint64_t delay = item.expiry - now.load(std::memory_order_relaxed);
+	std::size_t level = 0U;
+	while(level < LEVEL_COUNT - 1U && delay >= (uint64_t{1U} << (SLOT_BITS * (level + 1U))))
+		level++;
+	const auto slot = (item.expiry >> (SLOT_BITS * level)) & (SLOT_COUNT - 1U);
+	levels[level][slot].emplace_back(std::move(item));
+}
+
+void TimerWheel::Cascade(std::size_t level)
+{
+	const auto tick = now.load(std::memory_order_relaxed);
+	Slot items;
+	std::swap(items, levels[level][(tick >> (SLOT_BITS * level)) & (SLOT_COUNT - 1U)]);
+	for(auto& item : items)
+		if(!item.entry.expired())
+			Insert(std::move(item));
+}
+
+} // namespace Ignis::Multirole
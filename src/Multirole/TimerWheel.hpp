@@ -0,0 +1,78 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace Ignis::Multirole
+{
+
+// Hierarchical timing wheel with a resolution of one second, meant for the
+// coarse deadlines of a large number of connections. A single asio timer
+// ticks the wheel, scheduling an entry is constant time and entries that
+// expire (as in, their owner is destroyed) are just dropped when reached.
+// Deadlines longer than the wheel's span are clamped to its span.
+class TimerWheel final
+{
+public:
+	class IEntry
+	{
+	public:
+		// Called from the wheel's io context once the scheduled time is
+		// reached, must not block. Entries are not rescheduled automatically.
+		virtual void OnTimeout() noexcept = 0;
+	protected:
+		inline ~IEntry() noexcept = default;
+	};
+
+	TimerWheel(boost::asio::io_context& ioCtx);
+
+	// Number of seconds elapsed since construction. Cheap enough to be
+	// used for marking activity on every read or write.
+	uint64_t Now() const noexcept;
+
+	// Calls entry's OnTimeout after the given number of seconds, if the
+	// entry is still alive by then.
+	void Schedule(std::weak_ptr<IEntry> entry, unsigned int seconds);
+
+	// Cancels the ticking of the wheel, scheduled entries are never called.
+	void Stop() noexcept;
+private:
+	static constexpr std::size_t SLOT_BITS = 6U;
+	static constexpr std::size_t SLOT_COUNT = 1U << SLOT_BITS;
+	static constexpr std::size_t LEVEL_COUNT = 3U; // ~72 hours of span.
+	static constexpr uint64_t MAX_DELAY = (1U << (SLOT_BITS * LEVEL_COUNT)) - 1U;
+
+	struct Item
+	{
+		std::weak_ptr<IEntry> entry;
+		uint64_t expiry;
+	};
+
+	using Slot = std::vector<Item>;
+
+	boost::asio::steady_timer timer;
+	std::atomic<uint64_t> now;
+	std::array<std::array<Slot, SLOT_COUNT>, LEVEL_COUNT> levels;
+	bool stopped;
+	std::mutex mLevels;
+
+	void DoTick();
+
+	// Places an item on the level and slot corresponding to its expiry.
+	// NOTE: mLevels must be locked.
+	void Insert(Item&& item);
+
+	// Moves the items of the current slot of a level to lower levels.
+	// NOTE: mLevels must be locked.
+	void Cascade(std::size_t level);
+};
+
+} // namespace Ignis::Multirole
+
+#endif // TIMERWHEEL_HPP
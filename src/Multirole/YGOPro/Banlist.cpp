@@ -1,21 +1,64 @@
 #include "Banlist.hpp"
 
+#include <algorithm>
+#include <limits>
+
+#include "CardDatabase.hpp"
+
 namespace YGOPro
 {
 
-Banlist::Banlist(bool whitelist, DictType dict) noexcept :
+// public
+
+Banlist::Banlist(bool whitelist, DictType dict) :
 	whitelist(whitelist),
 	dict(std::move(dict))
-{}
+{
+	AddDictEntries(this->dict);
+}
+
+Banlist::Banlist(const Banlist& other, const CardDatabase& db) :
+	whitelist(other.whitelist)
+{
+	const auto& d = other.dict;
+	for(const auto& card : db)
+	{
+		if(card.alias == 0U || d.count(card.code) != 0U)
+			continue;
+		if(auto search = d.find(card.alias); search != d.end())
+			entries.push_back({card.code, search->second});
+	}
+	AddDictEntries(d);
+}
 
 bool Banlist::IsWhitelist() const noexcept
 {
 	return whitelist;
 }
 
-const Banlist::DictType& Banlist::Dict() const noexcept
+int32_t Banlist::Limit(uint32_t code) const noexcept
+{
+	const auto it = std::lower_bound(entries.cbegin(), entries.cend(), code,
+	[](const Entry& e, uint32_t value)
+	{
+		return e.code < value;
+	});
+	if(it != entries.cend() && it->code == code)
+		return it->count;
+	return whitelist ? 0 : std::numeric_limits<int32_t>::max();
+}
+
+// private
+
+void Banlist::AddDictEntries(const DictType& d)
 {
-	return dict;
+	entries.reserve(entries.size() + d.size());
+	for(const auto& kv : d)
+		entries.push_back({kv.first, kv.second});
+	std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs)
+	{
+		return lhs.code < rhs.code;
+	});
 }
 
 } // namespace YGOPro
@@ -3,22 +3,45 @@
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace YGOPro
 {
 
+class CardDatabase;
+
 class Banlist final
 {
 public:
 	using DictType = std::unordered_map<uint32_t /*code*/, int32_t /*count*/>;
 
-	Banlist(bool whitelist, DictType dict) noexcept;
+	Banlist(bool whitelist, DictType dict);
+
+	// Compiles the banlist against a card database: cards that are an
+	// alias of a listed card (and are not listed themselves) get the count
+	// of the card they alias, so checking a card takes a single lookup.
+	// The result does not keep the dictionary, so it can't be compiled
+	// again.
+	Banlist(const Banlist& other, const CardDatabase& db);
 
 	bool IsWhitelist() const noexcept;
-	const DictType& Dict() const noexcept;
+
+	// Maximum number of copies allowed for the given card, taking aliases
+	// into account if compiled. Not listed cards are either not allowed
+	// (whitelist) or unrestricted (INT32_MAX).
+	int32_t Limit(uint32_t code) const noexcept;
 private:
+	struct Entry
+	{
+		uint32_t code;
+		int32_t count;
+	};
+
 	const bool whitelist;
-	DictType dict;
+	DictType dict; // NOTE: Empty once compiled.
+	std::vector<Entry> entries; // NOTE: Sorted by code.
+
+	void AddDictEntries(const DictType& d);
 };
 
 using BanlistPtr = std::shared_ptr<Banlist>;
@@ -1,9 +1,21 @@
 #include "CardDatabase.hpp"
 
-#include <cstring>
-#include <stdexcept> // std::runtime_error
+#include <algorithm>
+#include <atomic>
+#include <cstdio> // std::rename, std::remove
+#include <cstring> // std::memcpy
+#include <fstream>
 #include <string>
+#include <type_traits>
 
+#ifdef _WIN32
+#include <process.h> // _getpid
+#else
+#include <unistd.h> // getpid
+#endif // _WIN32
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <sqlite3.h>
 
 #include "Constants.hpp"
@@ -11,201 +23,288 @@
 namespace YGOPro
 {
 
-static constexpr const char* DB_SCHEMAS =
-R"(
-CREATE TABLE "datas" (
-	"id"        INTEGER,
-	"ot"        INTEGER,
-	"alias"     INTEGER,
-	"setcode"   INTEGER,
-	"type"      INTEGER,
-	"atk"       INTEGER,
-	"def"       INTEGER,
-	"level"     INTEGER,
-	"race"      INTEGER,
-	"attribute" INTEGER,
-	"category"  INTEGER,
-	PRIMARY KEY("id")
-);
-CREATE TABLE "texts" (
-	"id"    INTEGER,
-	"name"  TEXT,
-	"desc"  TEXT,
-	"str1"  TEXT,
-	"str2"  TEXT,
-	"str3"  TEXT,
-	"str4"  TEXT,
-	"str5"  TEXT,
-	"str6"  TEXT,
-	"str7"  TEXT,
-	"str8"  TEXT,
-	"str9"  TEXT,
-	"str10" TEXT,
-	"str11" TEXT,
-	"str12" TEXT,
-	"str13" TEXT,
-	"str14" TEXT,
-	"str15" TEXT,
-	"str16" TEXT,
-	PRIMARY KEY("id")
-);
-)";
+namespace
+{
 
-static constexpr const char* ATTACH_STMT =
-R"(
-ATTACH ? AS toMerge;
-)";
+constexpr uint32_t IMAGE_MAGIC = 0x4244434D; // "MCDB"
+constexpr uint32_t IMAGE_VERSION = 1U;
 
-static constexpr const char* MERGE_DATAS_STMT =
-R"(
-INSERT OR REPLACE INTO datas SELECT * FROM toMerge.datas;
-)";
+struct ImageHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t count;
+	uint64_t checksum; // Of the cards that follow the header.
+};
 
-static constexpr const char* MERGE_TEXTS_STMT =
-R"(
-INSERT OR REPLACE INTO texts SELECT * FROM toMerge.texts;
-)";
+// Unique to this process and call, so that several instances writing the
+// same image at once (e.g: during a handoff) never share a temporary file.
+std::string TemporaryPath(std::string_view path)
+{
+	static std::atomic<unsigned int> counter{0U};
+#ifdef _WIN32
+	const auto pid = _getpid();
+#else
+	const auto pid = getpid();
+#endif // _WIN32
+	return std::string(path) + '.' + std::to_string(pid) + '.' +
+		std::to_string(counter++) + ".tmp";
+}
 
-static constexpr const char* DETACH_STMT =
-R"(
-DETACH toMerge;
-)";
+// 64-bit FNV-1a.
+uint64_t Checksum(const uint8_t* data, std::size_t size) noexcept
+{
+	uint64_t hash = 0xCBF29CE484222325;
+	for(std::size_t i = 0U; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3;
+	}
+	return hash;
+}
 
-static constexpr const char* SEARCH_STMT =
-R"(
-SELECT id,alias,setcode,type,atk,def,level,race,attribute
-FROM datas WHERE datas.id = ?;
-)";
+} // namespace
 
-static constexpr const char* SEARCH2_STMT =
+static constexpr const char* SELECT_ALL_STMT =
 R"(
-SELECT ot,category
-FROM datas WHERE datas.id = ?;
+SELECT id,ot,alias,setcode,type,atk,def,level,race,attribute,category
+FROM datas;
 )";
 
-CardDatabase::CardDatabase() : CardDatabase(":memory:")
-{}
+CardDatabase::CardDatabase() :
+	first(nullptr),
+	last(nullptr)
+{
+	static_assert(std::is_trivially_copyable_v<Card>);
+	static_assert(sizeof(Card) == 64U, "Card layout is part of the image format");
+}
 
-CardDatabase::CardDatabase(std::string_view absFilePath)
+CardDatabase::CardDatabase(const std::vector<CardSetPtr>& sets) : CardDatabase()
 {
-	// Create database
-	if(sqlite3_open(absFilePath.data(), &db) != SQLITE_OK)
-		throw std::runtime_error(sqlite3_errmsg(db));
-	// Prepare database
-	char* err = nullptr;
-	if(sqlite3_exec(db, DB_SCHEMAS, nullptr, nullptr, &err) == SQLITE_ABORT)
+	std::size_t count = 0U;
+	for(const auto& set : sets)
+		count += set->size();
+	cards.reserve(count);
+	// NOTE: Inserting the sets in reverse so the stable merge leaves the
+	// card of the set with the highest precedence at the front of its run,
+	// which is the one kept.
+	std::vector<std::size_t> bounds{0U}; // Where each set starts and ends.
+	for(auto it = sets.rbegin(); it != sets.rend(); ++it)
 	{
-		std::string errStr(err);
-		sqlite3_free(err);
-		sqlite3_close(db);
-		throw std::runtime_error(errStr);
+		cards.insert(cards.end(), (*it)->begin(), (*it)->end());
+		bounds.push_back(cards.size());
 	}
-	// Prepare attach statement
-	if(sqlite3_prepare_v2(db, ATTACH_STMT, -1, &aStmt, nullptr) != SQLITE_OK)
+	// Sets are already sorted, so merge them two adjacent ones at a time
+	// (which keeps it stable) until there is a single run left.
+	while(bounds.size() > 2U)
 	{
-		std::string errStr(sqlite3_errmsg(db));
-		sqlite3_close(db);
-		throw std::runtime_error(errStr);
+		std::vector<std::size_t> merged{0U};
+		for(std::size_t i = 2U; i < bounds.size(); i += 2U)
+		{
+			std::inplace_merge(
+				cards.begin() + bounds[i - 2U],
+				cards.begin() + bounds[i - 1U],
+				cards.begin() + bounds[i],
+			[](const Card& c1, const Card& c2)
+			{
+				return c1.code < c2.code;
+			});
+			merged.push_back(bounds[i]);
+		}
+		if(bounds.size() % 2U == 0U) // Odd number of runs, last one is left as is.
+			merged.push_back(bounds.back());
+		bounds = std::move(merged);
 	}
-	// Prepare card data search by id statement
-	if(sqlite3_prepare_v2(db, SEARCH_STMT, -1, &sStmt, nullptr) != SQLITE_OK)
+	cards.erase(std::unique(cards.begin(), cards.end(),
+	[](const Card& c1, const Card& c2)
+	{
+		return c1.code == c2.code;
+	}), cards.end());
+	cards.shrink_to_fit();
+	first = cards.data();
+	last = cards.data() + cards.size();
+}
+
+CardDatabase::~CardDatabase() noexcept = default;
+
+CardDatabase::CardSetPtr CardDatabase::ReadSet(std::string_view absFilePath) noexcept
+{
+	sqlite3* db = nullptr;
+	if(sqlite3_open_v2(absFilePath.data(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
 	{
-		std::string errStr(sqlite3_errmsg(db));
-		sqlite3_finalize(aStmt);
 		sqlite3_close(db);
-		throw std::runtime_error(errStr);
+		return nullptr;
 	}
-	// Prepare extra data search by id statement
-	if(sqlite3_prepare_v2(db, SEARCH2_STMT, -1, &s2Stmt, nullptr) != SQLITE_OK)
+	sqlite3_stmt* stmt = nullptr;
+	if(sqlite3_prepare_v2(db, SELECT_ALL_STMT, -1, &stmt, nullptr) != SQLITE_OK)
 	{
-		std::string errStr(sqlite3_errmsg(db));
-		sqlite3_finalize(sStmt);
-		sqlite3_finalize(aStmt);
 		sqlite3_close(db);
-		throw std::runtime_error(errStr);
+		return nullptr;
 	}
-}
-
-CardDatabase::~CardDatabase() noexcept
-{
-	sqlite3_finalize(s2Stmt);
-	sqlite3_finalize(sStmt);
-	sqlite3_finalize(aStmt);
+	auto cards = std::make_shared<CardSet>();
+	int rc = SQLITE_OK;
+	while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+	{
+		Card& c = cards->emplace_back();
+		c.code = sqlite3_column_int(stmt, 0);
+		c.extra.scope = sqlite3_column_int(stmt, 1);
+		c.alias = sqlite3_column_int(stmt, 2);
+		const auto dbSetcodes = static_cast<uint64_t>(sqlite3_column_int64(stmt, 3));
+		for(std::size_t i = 0U; i < SETCODES; i++)
+			c.setcodes[i] = (dbSetcodes >> (i * 16U)) & 0xFFFF;
+		c.setcodes[SETCODES] = c.setcodes[SETCODES + 1U] = 0U;
+		c.type = sqlite3_column_int(stmt, 4);
+		c.attack = sqlite3_column_int(stmt, 5);
+		c.defense = sqlite3_column_int(stmt, 6);
+		c.linkMarker = (c.type & TYPE_LINK) != 0U ? c.defense : 0;
+		c.defense = (c.type & TYPE_LINK) != 0U ? 0 : c.defense;
+		const auto dbLevel = sqlite3_column_int(stmt, 7);
+		c.level = dbLevel & 0x800000FF;
+		c.lscale = (dbLevel >> 24U) & 0xFF;
+		c.rscale = (dbLevel >> 16U) & 0xFF;
+		c.race = sqlite3_column_int(stmt, 8);
+		c.attribute = sqlite3_column_int(stmt, 9);
+		c.extra.category = sqlite3_column_int(stmt, 10);
+	}
+	sqlite3_finalize(stmt);
 	sqlite3_close(db);
+	if(rc != SQLITE_DONE)
+		return nullptr;
+	std::sort(cards->begin(), cards->end(),
+	[](const Card& c1, const Card& c2)
+	{
+		return c1.code < c2.code;
+	});
+	cards->shrink_to_fit();
+	return cards;
 }
 
-bool CardDatabase::Merge(std::string_view absFilePath) noexcept
+bool CardDatabase::LoadImage(std::string_view absFilePath, uint64_t key) noexcept
 {
-	sqlite3_reset(aStmt);
-	sqlite3_bind_text(aStmt, 1, absFilePath.data(), -1, SQLITE_TRANSIENT);
-	if(sqlite3_step(aStmt) != SQLITE_DONE)
+	using namespace boost::interprocess;
+	try
+	{
+		const file_mapping file(absFilePath.data(), read_only);
+		auto region = std::make_unique<mapped_region>(file, read_only);
+		const std::size_t size = region->get_size();
+		if(size < sizeof(ImageHeader))
+			return false;
+		const auto* ptr = static_cast<const uint8_t*>(region->get_address());
+		ImageHeader header{};
+		std::memcpy(&header, ptr, sizeof(ImageHeader));
+		ptr += sizeof(ImageHeader);
+		const std::size_t cardsSize = size - sizeof(ImageHeader);
+		if(header.magic != IMAGE_MAGIC || header.version != IMAGE_VERSION ||
+		   header.key != key || cardsSize % sizeof(Card) != 0U ||
+		   header.count != cardsSize / sizeof(Card) ||
+		   header.checksum != Checksum(ptr, cardsSize))
+			return false;
+		cards.clear();
+		cards.shrink_to_fit();
+		// NOTE: The header keeps cards aligned as the mapping is page-aligned.
+		first = reinterpret_cast<const Card*>(ptr);
+		last = first + header.count;
+		image = std::move(region);
+		return true;
+	}
+	catch(const std::exception&)
+	{
 		return false;
-	sqlite3_exec(db, MERGE_DATAS_STMT, nullptr, nullptr, nullptr);
-	sqlite3_exec(db, MERGE_TEXTS_STMT, nullptr, nullptr, nullptr);
-	sqlite3_exec(db, DETACH_STMT, nullptr, nullptr, nullptr);
-	return true;
+	}
 }
 
-const OCG_CardData& CardDatabase::DataFromCode(uint32_t code) const
+bool CardDatabase::SaveImage(std::string_view absFilePath, uint64_t key) const noexcept
 {
-	std::scoped_lock lock(mDataCache);
-	if(auto search = dataCache.find(code); search != dataCache.end())
-		return search->second;
-	std::scoped_lock lock2(mDb);
-	auto AllocSetcodes = [&](uint64_t dbVal) -> uint16_t*
+	const std::size_t cardsSize = (last - first) * sizeof(Card);
+	const ImageHeader header
 	{
-		static constexpr std::size_t SETCODES = 4U;
-		auto p = decltype(scCache)::value_type(code, std::make_unique<uint16_t[]>(SETCODES + 1U));
-		auto& setcodes = scCache.emplace(std::move(p)).first->second;
-		for(std::size_t i = 0U; i < SETCODES; i++)
-			setcodes[i] = (dbVal >> (i * 16U)) & 0xFFFF;
-		setcodes[SETCODES] = 0U;
-		return setcodes.get();
+		IMAGE_MAGIC,
+		IMAGE_VERSION,
+		key,
+		static_cast<uint64_t>(last - first),
+		Checksum(reinterpret_cast<const uint8_t*>(first), cardsSize)
 	};
-	OCG_CardData& cd = dataCache[code]; // implicit insertion
-	sqlite3_reset(sStmt);
-	sqlite3_bind_int(sStmt, 1, code);
-	if(sqlite3_step(sStmt) == SQLITE_ROW)
+	// NOTE: Written to a temporary file first so that processes mapping the
+	// previous image (if any) are unaffected and never see a partial one.
+	const std::string tmpPath = TemporaryPath(absFilePath);
+	bool ok = false;
 	{
-		cd.code = sqlite3_column_int(sStmt, 0);
-		cd.alias = sqlite3_column_int(sStmt, 1);
-		cd.setcodes = AllocSetcodes(sqlite3_column_int64(sStmt, 2));
-		cd.type = sqlite3_column_int(sStmt, 3);
-		cd.attack = sqlite3_column_int(sStmt, 4);
-		cd.defense = sqlite3_column_int(sStmt, 5);
-		cd.link_marker = (cd.type & TYPE_LINK) != 0U ? cd.defense : 0;
-		cd.defense = (cd.type & TYPE_LINK) != 0U ? 0 : cd.defense;
-		const auto dbLevel = sqlite3_column_int(sStmt, 6);
-		cd.level = dbLevel & 0x800000FF;
-		cd.lscale = (dbLevel >> 24U) & 0xFF;
-		cd.rscale = (dbLevel >> 16U) & 0xFF;
-		cd.race = sqlite3_column_int(sStmt, 7);
-		cd.attribute = sqlite3_column_int(sStmt, 8);
+		std::ofstream f(tmpPath, std::ios_base::binary | std::ios_base::trunc);
+		if(!f.is_open())
+			return false;
+		f.write(reinterpret_cast<const char*>(&header), sizeof(ImageHeader));
+		f.write(reinterpret_cast<const char*>(first), static_cast<std::streamsize>(cardsSize));
+		ok = static_cast<bool>(f.flush());
 	}
-	return cd;
+	if(ok && std::rename(tmpPath.data(), std::string(absFilePath).data()) == 0)
+		return true;
+	std::remove(tmpPath.data());
+	return false;
+}
+
+std::size_t CardDatabase::Size() const noexcept
+{
+	return static_cast<std::size_t>(last - first);
 }
 
-void CardDatabase::DataUsageDone([[maybe_unused]] const OCG_CardData& data) const
+const CardDatabase::Card* CardDatabase::begin() const noexcept
 {
-	// We could remove the elements here, but then what would be the
-	// the point of the cache?
+	return first;
 }
 
-const CardExtraData& CardDatabase::ExtraFromCode(uint32_t code) noexcept
+const CardDatabase::Card* CardDatabase::end() const noexcept
 {
-	std::scoped_lock lock(mExtraCache);
-	if(auto search = extraCache.find(code); search != extraCache.end())
-		return search->second;
-	std::scoped_lock lock2(mDb);
-	CardExtraData& ced = extraCache[code]; // implicit insertion
-	sqlite3_reset(s2Stmt);
-	sqlite3_bind_int(s2Stmt, 1, code);
-	if(sqlite3_step(s2Stmt) == SQLITE_ROW)
+	return last;
+}
+
+const CardDatabase::Card* CardDatabase::CardFromCode(uint32_t code) const noexcept
+{
+	const Card* it = std::lower_bound(first, last, code,
+	[](const Card& c, uint32_t value)
 	{
-		ced.scope = sqlite3_column_int(s2Stmt, 0);
-		ced.category = sqlite3_column_int(s2Stmt, 1);
-	}
-	return ced;
+		return c.code < value;
+	});
+	if(it == last || it->code != code)
+		return nullptr;
+	return it;
+}
+
+CardDatabase::CardData CardDatabase::DataFromCode(uint32_t code) const
+{
+	const auto* c = CardFromCode(code);
+	if(c == nullptr)
+		return {};
+	return
+	{
+		c->code,
+		c->alias,
+		// NOTE: The core only reads the setcodes, which might be on a
+		// read-only mapping.
+		const_cast<uint16_t*>(c->setcodes.data()),
+		c->type,
+		c->level,
+		c->attribute,
+		c->race,
+		c->attack,
+		c->defense,
+		c->lscale,
+		c->rscale,
+		c->linkMarker
+	};
+}
+
+void CardDatabase::DataUsageDone([[maybe_unused]] const CardData& data) const
+{
+	// Nothing to do, all the data lives as long as the database does.
+}
+
+const CardExtraData& CardDatabase::ExtraFromCode(uint32_t code) const noexcept
+{
+	static constexpr CardExtraData EMPTY{};
+	if(const auto* c = CardFromCode(code); c != nullptr)
+		return c->extra;
+	return EMPTY;
 }
 
 } // namespace YGOPro
@@ -1,14 +1,18 @@
 #ifndef CARDDATABASE_HPP
 #define CARDDATABASE_HPP
-#include <string_view>
+#include <array>
 #include <memory>
-#include <mutex>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 #include "../Core/IDataSupplier.hpp"
 
-struct sqlite3;
-struct sqlite3_stmt;
+namespace boost::interprocess
+{
+
+class mapped_region;
+
+} // namespace boost::interprocess
 
 namespace YGOPro
 {
@@ -19,41 +23,82 @@ struct CardExtraData
 	uint32_t category;
 };
 
+// Card data of all the merged databases, fully loaded in memory.
+// Immutable once constructed (or once an image is loaded) so it can be
+// shared and lookups don't require synchronization.
 class CardDatabase final : public Ignis::Multirole::Core::IDataSupplier
 {
 public:
-	// Creates a in-memory database
+	static constexpr std::size_t SETCODES = 4U;
+
+	// NOTE: Also the layout of each card on images.
+	struct Card
+	{
+		uint32_t code;
+		uint32_t alias;
+		uint32_t type;
+		uint32_t level;
+		uint32_t attribute;
+		uint32_t race;
+		int32_t attack;
+		int32_t defense;
+		uint32_t lscale;
+		uint32_t rscale;
+		uint32_t linkMarker;
+		CardExtraData extra;
+		// NOTE: Zero terminated, last element is always 0.
+		std::array<uint16_t, SETCODES + 2U> setcodes;
+	};
+
+	// Cards of a single database file, sorted by code. Kept around by the
+	// owner of the databases so that only the files that change need to be
+	// read (and sorted) again.
+	using CardSet = std::vector<Card>;
+	using CardSetPtr = std::shared_ptr<const CardSet>;
+
+	// Reads all the cards of a database file, nullptr if unable to.
+	static CardSetPtr ReadSet(std::string_view absFilePath) noexcept;
+
+	// Creates an empty database
 	CardDatabase();
 
-	// Closes the database
+	// Creates the amalgamation of the given sets, cards of a set replace
+	// the cards with the same code of the sets before it.
+	explicit CardDatabase(const std::vector<CardSetPtr>& sets);
+
 	~CardDatabase() noexcept;
 
-	// Opens or creates a disk database
-	CardDatabase(std::string_view absFilePath);
+	// Replaces the cards with the ones of an image written by SaveImage,
+	// mapping the file in memory instead of reading it. Fails if the image
+	// is missing, corrupted, from another version or was saved with a
+	// different key.
+	bool LoadImage(std::string_view absFilePath, uint64_t key) noexcept;
 
-	// Add a new database to the amalgamation
-	bool Merge(std::string_view absFilePath) noexcept;
+	// Writes the cards to a binary image, the key is an arbitrary value
+	// that must match when loading it.
+	bool SaveImage(std::string_view absFilePath, uint64_t key) const noexcept;
 
-	// Core::IDataSupplier overrides
-	const OCG_CardData& DataFromCode(uint32_t code) const override;
-	void DataUsageDone(const OCG_CardData& data) const override;
+	// Number of cards in the database.
+	std::size_t Size() const noexcept;
 
-	// Query extra data
-	const CardExtraData& ExtraFromCode(uint32_t code) noexcept;
-private:
-	sqlite3* db{};
-	sqlite3_stmt* aStmt{};
-	sqlite3_stmt* sStmt{};
-	sqlite3_stmt* s2Stmt{};
+	// Iteration over all the cards, in ascending code order.
+	const Card* begin() const noexcept;
+	const Card* end() const noexcept;
 
-	mutable std::mutex mDb;
+	// Card with the given code, nullptr if there is no such card.
+	const Card* CardFromCode(uint32_t code) const noexcept;
 
-	mutable std::unordered_map<uint32_t, OCG_CardData> dataCache;
-	mutable std::unordered_map<uint32_t, std::unique_ptr<uint16_t[]>> scCache;
-	mutable std::mutex mDataCache;
+	// Core::IDataSupplier overrides
+	CardData DataFromCode(uint32_t code) const override;
+	void DataUsageDone(const CardData& data) const override;
 
-	mutable std::unordered_map<uint32_t, CardExtraData> extraCache;
-	mutable std::mutex mExtraCache;
+	// Query extra data
+	const CardExtraData& ExtraFromCode(uint32_t code) const noexcept;
+private:
+	CardSet cards;
+	std::unique_ptr<boost::interprocess::mapped_region> image;
+	const Card* first;
+	const Card* last;
 };
 
 } // namespace YGOPro
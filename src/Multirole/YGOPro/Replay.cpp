@@ -1,10 +1,14 @@
 #include "Replay.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
+#include <thread>
 
 #include "Config.hpp"
 #include "Constants.hpp"
+#include "ReplayFormat.hpp"
 #include "StringUtils.hpp"
 #include "LZMA/LzmaEnc.h"
 #include "LZMA/Alloc.h" // g_Alloc
@@ -22,69 +26,87 @@ constexpr auto ENCODED_SERVER_VERSION = [](const auto& v) constexpr -> uint32_t
 
 #include "../../Write.inl"
 
-enum ReplayTypes
+namespace
 {
-	REPLAY_YRP1 = 0x31707279,
-	REPLAY_YRPX = 0x58707279
-};
 
-enum ReplayFlags
+// Level that uses the fast mode of the encoder (hash chain match finder),
+// several times faster for only a slightly bigger result.
+constexpr int FAST_MODE_LEVEL = 1;
+
+// Lowest level that uses the binary tree match finder, the only one that can
+// run on threads of its own.
+constexpr int MULTI_THREAD_MIN_LEVEL = 5;
+
+// Encodes that may find matches on their own threads at the same time in the
+// whole process, each one uses two. Further encodes use a single thread
+// until one of these finishes.
+std::atomic<unsigned int>& MultiThreadSlots() noexcept
+{
+	static std::atomic<unsigned int> slots{std::max(1U, std::thread::hardware_concurrency() / 4U)};
+	return slots;
+}
+
+bool TryAcquireMultiThreadSlot() noexcept
+{
+	auto& slots = MultiThreadSlots();
+	unsigned int free = slots.load();
+	while(free != 0U)
+		if(slots.compare_exchange_weak(free, free - 1U))
+			return true;
+	return false;
+}
+
+void ReleaseMultiThreadSlot() noexcept
+{
+	++MultiThreadSlots();
+}
+
+// Encoder input, reads a sequence of byte ranges as if they were contiguous.
+struct InStream
 {
-	REPLAY_COMPRESSED     = 0x1,
-	REPLAY_TAG            = 0x2,
-	REPLAY_DECODED        = 0x4,
-	REPLAY_SINGLE_MODE    = 0x8,
-	REPLAY_LUA64          = 0x10,
-	REPLAY_NEWREPLAY      = 0x20,
-	REPLAY_HAND_TEST      = 0x40,
-	REPLAY_DIRECT_SEED    = 0x80,
-	REPLAY_64BIT_DUELFLAG = 0x100,
+	ISeqInStream vt;
+	std::vector<std::pair<const uint8_t*, std::size_t>> parts;
+	std::size_t part;
+	std::size_t offset; // Within the current part.
 };
 
-struct ReplayHeader
+SRes SeqInStreamRead(const ISeqInStream* p, void* buf, size_t* size)
+{
+	auto* in = CONTAINER_FROM_VTBL(p, InStream, vt);
+	auto* dst = static_cast<uint8_t*>(buf);
+	std::size_t read = 0U;
+	while(read < *size && in->part < in->parts.size())
+	{
+		const auto& [data, count] = in->parts[in->part];
+		const std::size_t n = std::min(*size - read, count - in->offset);
+		std::memcpy(dst + read, data + in->offset, n);
+		read += n;
+		if((in->offset += n) == count)
+		{
+			in->part++;
+			in->offset = 0U;
+		}
+	}
+	*size = read; // NOTE: 0 means end of stream.
+	return SZ_OK;
+}
+
+// Encoder output, appends to a vector.
+struct OutStream
 {
-	uint32_t type; // See ReplayTypes.
-	uint32_t version; // Unused atm, should be set to YGOPro::ClientVersion.
-	uint32_t flags; // See ReplayFlags.
-	uint32_t seed; // Unix timestamp for YRPX. Core duel seed for YRP.
-	uint32_t size; // Uncompressed size of whatever is after this header.
-	uint32_t hash; // Unused.
-	uint8_t props[8]; // Used for LZMA compression (check their apis).
+	ISeqOutStream vt;
+	std::vector<uint8_t>* bytes;
 };
 
-// ***** YRPX Binary format *****
-// ReplayHeader
-// team0Count [uint32_t]
-// team0Names [20 char16_t * team0Count]
-// team1Count [uint32_t]
-// team1Names [20 char16_t * team1Count]
-// duelFlags [uint64_t]
-// Core messages (repeat for number of messages):
-// 	msgType [uint8_t]
-// 	length [uint32_t]
-// 	data [uint8_t * length]
+size_t SeqOutStreamWrite(const ISeqOutStream* p, const void* buf, size_t size)
+{
+	auto* out = CONTAINER_FROM_VTBL(p, OutStream, vt);
+	const auto* src = static_cast<const uint8_t*>(buf);
+	out->bytes->insert(out->bytes->end(), src, src + size);
+	return size;
+}
 
-// ***** YRP Binary format *****
-// ReplayHeader
-// team0Count [uint32_t]
-// team0Names [20 char16_t * team0Count]
-// team1Count [uint32_t]
-// team1Names [20 char16_t * team1Count]
-// startingLP [uint32_t]
-// startingDrawCount [uint32_t]
-// drawCountPerTurn [uint32_t]
-// duelFlags [uint64_t]
-// Deck & Extra Decks (repeat for each duelist):
-// 	deckCount [uint32_t]
-// 	cards [uint32_t * deckCount]
-// 	extraCount [uint32_t]
-// 	cards [uint32_t * extraCount]
-// Extra cards:
-// 	count [uint32_t]
-// 	cards [uint32_t * count]
-// Core responses (repeat for number of responses):
-// 	length [uint8_t]
-// 	data [uint8_t * length]
+} // namespace
 
 Replay::Replay(
 	uint32_t unixTimestamp,
@@ -98,20 +120,16 @@ Replay::Replay(
 	startingDrawCount(info.startingDrawCount),
 	drawCountPerTurn(info.drawCountPerTurn),
 	duelFlags(HostInfo::OrDuelFlags(info.duelFlagsHigh, info.duelFlagsLow)),
-	extraCards(extraCards)
+	extraCards(extraCards),
+	lastResponseSize(0U)
 {}
 
-const std::vector<uint8_t>& Replay::Bytes() const noexcept
-{
-	return bytes;
-}
-
 void Replay::AddDuelist(uint8_t team, uint8_t pos, Duelist&& duelist) noexcept
 {
 	duelists[team].insert_or_assign(pos, duelist);
 }
 
-void Replay::RecordMsg(const std::vector<uint8_t>& msg) noexcept
+bool Replay::IsRecordable(const std::vector<uint8_t>& msg) noexcept
 {
 	// Filter out some useless messages.
 	switch(msg[0U])
@@ -123,7 +141,7 @@ void Replay::RecordMsg(const std::vector<uint8_t>& msg) noexcept
 				// Do not record player specific hints.
 				case 1U: case 2U:
 				case 3U: case 5U:
-					return;
+					return false;
 			}
 			break;
 		}
@@ -148,54 +166,64 @@ void Replay::RecordMsg(const std::vector<uint8_t>& msg) noexcept
 		case MSG_SELECT_CARD:
 		case MSG_SELECT_TRIBUTE:
 		case MSG_SELECT_UNSELECT_CARD:
-			return;
+			return false;
 	}
-	messages.emplace_back(msg);
+	return true;
+}
+
+void Replay::RecordMsg(const std::vector<uint8_t>& msg) noexcept
+{
+	if(!IsRecordable(msg))
+		return;
+	std::array<uint8_t, 5U> prefix{}; // msgType<1> + length<4>
+	uint8_t* ptr = prefix.data();
+	Write<uint8_t>(ptr, msg[0U]);
+	Write(ptr, static_cast<uint32_t>(msg.size() - 1U));
+	messages.Append(prefix.data(), prefix.size());
+	messages.Append(msg.data() + 1U, msg.size() - 1U);
 }
 
 void Replay::RecordResponse(const std::vector<uint8_t>& response) noexcept
 {
-	responses.emplace_back(response);
+	const auto length = static_cast<uint8_t>(response.size());
+	responses.Append(&length, 1U);
+	responses.Append(response.data(), response.size());
+	lastResponseSize = 1U + response.size();
 }
 
 void Replay::PopBackResponse() noexcept
 {
-	responses.pop_back();
+	responses.Truncate(lastResponseSize);
+	lastResponseSize = 0U;
 }
 
-void Replay::Serialize() noexcept
+std::size_t Replay::RecordedSize() const noexcept
 {
-	auto YRPXPastHeaderSize = [&]() -> std::size_t
-	{
-		std::size_t size =
-			8U + // team0Count<4> + team1Count<4>
-			8U;  // duelFlags<8>
-		// Size occupied by each duelist
-		size += 40U * (duelists[0U].size() + duelists[1U].size());
-		// Size occupied by all core messages.
-		size += [&]() -> std::size_t
-		{
-			std::size_t v{};
-			for(const auto& msg : messages)
-				v += msg.size() + 4U; // length.
-			return v;
-		}();
-		return size;
-	};
-	auto YRPPastHeaderSize = [&]() -> std::size_t
+	return messages.Size() + responses.Size();
+}
+
+bool Replay::UsesFastMode(const Compression& compression) const noexcept
+{
+	return compression.fastModeThreshold != 0U && RecordedSize() > compression.fastModeThreshold;
+}
+
+std::vector<uint8_t> Replay::Serialize(const Compression& compression) const noexcept
+{
+	const std::size_t duelistsSize =
+		8U + // team0Count<4> + team1Count<4>
+		40U * (duelists[0U].size() + duelists[1U].size()); // name<2 * 20>
+	const std::size_t yrpPastHeaderSize = [&]() -> std::size_t
 	{
 		std::size_t size =
-			8U + // team0Count<4> + team1Count<4>
+			duelistsSize +
 			8U + // startingLP<4> + startingDrawCount<4>
 			12U; // drawCountPerTurn<4> + duelFlags<8>
-		// Size occupied by each duelist and their decks.
+		// Size occupied by the decks of each duelist.
 		for(const auto& m : duelists)
 		{
 			for(const auto& d : m)
 			{
-				size +=
-					40U + // name<2 * 20>
-					8U;   // deckCount<4> + extraCount<4>
+				size += 8U; // deckCount<4> + extraCount<4>
 				size += d.second.main.size() * 4U;
 				size += d.second.extra.size() * 4U;
 			}
@@ -203,10 +231,11 @@ void Replay::Serialize() noexcept
 		// Size occupied by extra cards.
 		size += 4U + extraCards.size() * 4U;
 		// Size occupied by all player responses
-		for(const auto& r : responses)
-			size += r.size() + 1U; // length
+		size += responses.Size();
 		return size;
-	};
+	}();
+	// YRP replay is appended as the last core message of the YRPX replay.
+	const std::size_t yrpMsgBodySize = sizeof(ReplayHeader) + yrpPastHeaderSize;
 	// Write duelists count and their names.
 	auto WriteDuelists = [&](uint8_t*& ptr)
 	{
@@ -221,13 +250,20 @@ void Replay::Serialize() noexcept
 			}
 		}
 	};
-	// YRP replay is appended as a CORE message onto the YRPX messages list,
-	// for that reason, we serialize it first and as last step we serialize
-	// the whole YRPX past-the-header data.
-	[&](std::vector<uint8_t>& vec)
+	// NOTE: Only the parts of the past-the-header data that are not already
+	// recorded in the arenas are written here, the encoder then reads
+	// them and the arenas' chunks one after the other.
+	std::vector<uint8_t> yrpxHead(duelistsSize + 8U); // duelFlags<8>
+	{
+		uint8_t* ptr = yrpxHead.data();
+		WriteDuelists(ptr);
+		Write<uint64_t>(ptr, duelFlags);
+		// Number of bytes written shall equal yrpxHead.size().
+		assert(static_cast<std::size_t>(ptr - yrpxHead.data()) == yrpxHead.size());
+	}
+	std::vector<uint8_t> yrpHead(5U + yrpMsgBodySize - responses.Size()); // msgType<1> + length<4>
 	{
-		vec.resize(1U + sizeof(ReplayHeader) + YRPPastHeaderSize());
-		uint8_t* ptr = vec.data();
+		uint8_t* ptr = yrpHead.data();
 		auto WriteCodeVector = [&ptr](const std::vector<uint32_t>& vec)
 		{
 			Write(ptr, static_cast<uint32_t>(vec.size()));
@@ -236,6 +272,7 @@ void Replay::Serialize() noexcept
 		};
 		// NOLINTNEXTLINE: Message type, Called OLD_REPLAY_FORMAT in common.h.
 		Write<uint8_t>(ptr, 231U);
+		Write(ptr, static_cast<uint32_t>(yrpMsgBodySize));
 		// Replay header for YRP replay format.
 		Write(ptr, ReplayHeader
 		{
@@ -243,7 +280,7 @@ void Replay::Serialize() noexcept
 			ENCODED_SERVER_VERSION,
 			REPLAY_LUA64 | REPLAY_NEWREPLAY | REPLAY_DIRECT_SEED | REPLAY_64BIT_DUELFLAG,
 			seed,
-			static_cast<uint32_t>(YRPPastHeaderSize()),
+			static_cast<uint32_t>(yrpPastHeaderSize),
 			0U,
 			{}
 		});
@@ -265,37 +302,23 @@ void Replay::Serialize() noexcept
 		}
 		// Extra Cards.
 		WriteCodeVector(extraCards);
-		// Core responses.
-		for(const auto& r : responses)
-		{
-			Write(ptr, static_cast<uint8_t>(r.size()));
-			std::memcpy(ptr, r.data(), r.size());
-			ptr += r.size();
-		}
-		// Number of bytes written shall equal vec.size().
-		assert(static_cast<std::size_t>(ptr - vec.data()) == vec.size());
-	}(messages.emplace_back());
-	// Write past-the-header data for YRPX replay format.
-	auto pthData = [&]() -> std::vector<uint8_t>
+		// Number of bytes written shall equal yrpHead.size(), core responses
+		// follow right after.
+		assert(static_cast<std::size_t>(ptr - yrpHead.data()) == yrpHead.size());
+	}
+	// Past-the-header data for YRPX replay format, in order.
+	InStream in{{SeqInStreamRead}, {}, 0U, 0U};
+	in.parts.emplace_back(yrpxHead.data(), yrpxHead.size());
+	messages.ForEachChunk([&](const uint8_t* data, std::size_t count)
 	{
-		std::vector<uint8_t> vec(YRPXPastHeaderSize());
-		uint8_t* ptr = vec.data();
-		WriteDuelists(ptr);
-		// Duel flags.
-		Write<uint64_t>(ptr, duelFlags);
-		// Core messages.
-		for(const auto& msg : messages)
-		{
-			const std::size_t bodyLength = msg.size() - 1U;
-			Write<uint8_t>(ptr, msg[0U]);
-			Write(ptr, static_cast<uint32_t>(bodyLength));
-			std::memcpy(ptr, msg.data() + 1U, bodyLength);
-			ptr += bodyLength;
-		}
-		// Number of bytes written shall equal vec.size().
-		assert(static_cast<std::size_t>(ptr - vec.data()) == vec.size());
-		return vec;
-	}();
+		in.parts.emplace_back(data, count);
+	});
+	in.parts.emplace_back(yrpHead.data(), yrpHead.size());
+	responses.ForEachChunk([&](const uint8_t* data, std::size_t count)
+	{
+		in.parts.emplace_back(data, count);
+	});
+	const std::size_t pthSize = yrpxHead.size() + messages.Size() + yrpHead.size() + responses.Size();
 	// Replay header for YRPX replay format.
 	ReplayHeader header
 	{
@@ -303,41 +326,90 @@ void Replay::Serialize() noexcept
 		ENCODED_SERVER_VERSION,
 		REPLAY_LUA64 | REPLAY_NEWREPLAY | REPLAY_64BIT_DUELFLAG,
 		unixTimestamp,
-		static_cast<uint32_t>(pthData.size()),
+		static_cast<uint32_t>(pthSize),
 		0U,
 		{}
 	};
-	// Compress past-the-header data.
-	std::vector<uint8_t> compData(pthData.size() * 2U);
+	// Compress past-the-header data straight into the final binary replay,
+	// right after the space left for the header.
+	std::vector<uint8_t> bytes(sizeof(ReplayHeader));
+	OutStream out{{SeqOutStreamWrite}, &bytes};
 	CLzmaEncProps props;
 	LzmaEncProps_Init(&props);
-	props.numThreads = 1; // NOLINT: No multithreading.
-	SizeT destLen = compData.size();
-	SizeT outPropSize = LZMA_PROPS_SIZE;
-	LzmaEncode
-	(
-		compData.data(),
-		&destLen,
-		pthData.data(),
-		pthData.size(),
-		&props,
-		header.props,
-		&outPropSize,
-		0,
-		nullptr,
-		&g_Alloc,
-		&g_Alloc
-	);
-	compData.resize(destLen);
+	props.level = compression.level;
+	props.dictSize = compression.dictSize;
+	props.reduceSize = pthSize; // Don't allocate a dictionary bigger than needed.
+	props.numThreads = 1;
+	bool multiThread = false;
+	if(UsesFastMode(compression))
+		props.level = FAST_MODE_LEVEL;
+	else if(compression.multiThreadThreshold != 0U &&
+	        pthSize > compression.multiThreadThreshold &&
+	        compression.level >= MULTI_THREAD_MIN_LEVEL)
+		multiThread = TryAcquireMultiThreadSlot();
+	auto Encode = [&](int numThreads) -> SRes
+	{
+		props.numThreads = numThreads;
+		CLzmaEncHandle enc = LzmaEnc_Create(&g_Alloc);
+		SizeT outPropSize = LZMA_PROPS_SIZE;
+		LzmaEnc_SetProps(enc, &props);
+		LzmaEnc_SetDataSize(enc, pthSize);
+		LzmaEnc_WriteProperties(enc, header.props, &outPropSize);
+		const SRes res = LzmaEnc_Encode(enc, &out.vt, &in.vt, nullptr, &g_Alloc, &g_Alloc);
+		LzmaEnc_Destroy(enc, &g_Alloc, &g_Alloc);
+		return res;
+	};
+	if(multiThread)
+	{
+		// NOTE: Output is the same regardless of the number of threads, so
+		// if these could not be started it is simply done again on this one.
+		if(Encode(2) != SZ_OK) // NOLINT: Match finder thread + hashing thread.
+		{
+			bytes.resize(sizeof(ReplayHeader));
+			in.part = 0U;
+			in.offset = 0U;
+			Encode(1);
+		}
+		ReleaseMultiThreadSlot();
+	}
+	else
+		Encode(1);
 	header.flags |= REPLAY_COMPRESSED;
-	pthData = std::move(compData);
-	// Write final binary replay.
-	bytes.resize(sizeof(ReplayHeader) + pthData.size());
 	uint8_t* ptr = bytes.data();
 	Write<ReplayHeader>(ptr, header);
-	std::memcpy(ptr, pthData.data(), pthData.size());
-	// Remove message that was appended for serializing purposes.
-	messages.pop_back();
+	return bytes;
+}
+
+// private
+
+Replay::Arena::Arena() noexcept :
+	size(0U)
+{}
+
+std::size_t Replay::Arena::Size() const noexcept
+{
+	return size;
+}
+
+void Replay::Arena::Append(const uint8_t* data, std::size_t count) noexcept
+{
+	while(count != 0U)
+	{
+		const std::size_t offset = size % CHUNK_SIZE;
+		if(size / CHUNK_SIZE == chunks.size())
+			chunks.emplace_back(std::make_unique<uint8_t[]>(CHUNK_SIZE));
+		const std::size_t n = std::min(count, CHUNK_SIZE - offset);
+		std::memcpy(chunks.back().get() + offset, data, n);
+		data += n;
+		count -= n;
+		size += n;
+	}
+}
+
+void Replay::Arena::Truncate(std::size_t count) noexcept
+{
+	size -= std::min(count, size);
+	chunks.resize((size + CHUNK_SIZE - 1U) / CHUNK_SIZE);
 }
 
 } // namespace YGOPro
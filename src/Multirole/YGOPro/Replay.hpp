@@ -1,9 +1,10 @@
 #ifndef YGOPRO_REPLAY_HPP
 #define YGOPRO_REPLAY_HPP
+#include <algorithm>
 #include <array>
 #include <cstdint>
-#include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -23,23 +24,80 @@ public:
 		CodeVector extra;
 	};
 
+	// Settings used to compress the replay.
+	struct Compression
+	{
+		int level; // 0-9, same as LZMA's.
+		uint32_t dictSize; // 0 to use the default of the level.
+		// Replays with more recorded data than this use level 1 (the
+		// fastest) instead, 0 to never do so.
+		std::size_t fastModeThreshold;
+		// Replays with more uncompressed data than this find matches on two
+		// threads of their own when the process is not already doing so for
+		// enough other replays, 0 to never do so. Only used by levels 5-9.
+		std::size_t multiThreadThreshold;
+	};
+
 	Replay(
 		uint32_t unixTimestamp,
 		uint32_t seed,
 		const HostInfo& info,
 		const CodeVector& extraCards) noexcept;
 
-	const std::vector<uint8_t>& Bytes() const noexcept;
-
 	void AddDuelist(uint8_t team, uint8_t pos, Duelist&& duelist) noexcept;
 
+	// Whether RecordMsg keeps the message, some are filtered out.
+	static bool IsRecordable(const std::vector<uint8_t>& msg) noexcept;
+
 	void RecordMsg(const std::vector<uint8_t>& msg) noexcept;
 	void RecordResponse(const std::vector<uint8_t>& response) noexcept;
 
 	void PopBackResponse() noexcept;
 
-	void Serialize() noexcept;
+	// Amount of data recorded so far.
+	std::size_t RecordedSize() const noexcept;
+
+	// Whether Serialize would use the fast mode of the given settings.
+	bool UsesFastMode(const Compression& compression) const noexcept;
+
+	// Returns the final binary replay, compressed with the given settings.
+	std::vector<uint8_t> Serialize(const Compression& compression) const noexcept;
 private:
+	// Bytes appended one after the other into fixed-size chunks, so that
+	// recording never moves what was recorded before and doesn't need a
+	// heap allocation per message.
+	class Arena
+	{
+	public:
+		Arena() noexcept;
+
+		std::size_t Size() const noexcept;
+
+		void Append(const uint8_t* data, std::size_t count) noexcept;
+
+		// Removes the given number of bytes from the end.
+		void Truncate(std::size_t count) noexcept;
+
+		// Calls f(data, count) for each chunk in order, which together hold
+		// all the bytes appended.
+		template<typename Function>
+		void ForEachChunk(Function f) const noexcept
+		{
+			std::size_t remaining = size;
+			for(const auto& chunk : chunks)
+			{
+				const std::size_t count = std::min(remaining, CHUNK_SIZE);
+				f(chunk.get(), count);
+				remaining -= count;
+			}
+		}
+	private:
+		static constexpr std::size_t CHUNK_SIZE = 16384U;
+
+		std::vector<std::unique_ptr<uint8_t[]>> chunks;
+		std::size_t size;
+	};
+
 	const uint32_t unixTimestamp;
 	const uint32_t seed;
 	const uint32_t startingLP;
@@ -49,10 +107,10 @@ private:
 	const CodeVector extraCards;
 
 	std::array<std::map<uint8_t, Duelist>, 2U> duelists;
-	std::list<std::vector<uint8_t>> messages;
-	std::list<std::vector<uint8_t>> responses;
-
-	std::vector<uint8_t> bytes;
+	// Recorded already in their final layout, see Replay.cpp.
+	Arena messages; // Core messages for YRPX.
+	Arena responses; // Core responses for YRP.
+	std::size_t lastResponseSize; // Bytes taken by the last response.
 };
 
 } // namespace YGOPro
@@ -0,0 +1,74 @@
+#ifndef YGOPRO_REPLAYFORMAT_HPP
+#define YGOPRO_REPLAYFORMAT_HPP
+#include <cstdint>
+
+namespace YGOPro
+{
+
+enum ReplayTypes
+{
+	REPLAY_YRP1 = 0x31707279,
+	REPLAY_YRPX = 0x58707279
+};
+
+enum ReplayFlags
+{
+	REPLAY_COMPRESSED     = 0x1,
+	REPLAY_TAG            = 0x2,
+	REPLAY_DECODED        = 0x4,
+	REPLAY_SINGLE_MODE    = 0x8,
+	REPLAY_LUA64          = 0x10,
+	REPLAY_NEWREPLAY      = 0x20,
+	REPLAY_HAND_TEST      = 0x40,
+	REPLAY_DIRECT_SEED    = 0x80,
+	REPLAY_64BIT_DUELFLAG = 0x100,
+};
+
+struct ReplayHeader
+{
+	uint32_t type; // See ReplayTypes.
+	uint32_t version; // Unused atm, should be set to YGOPro::ClientVersion.
+	uint32_t flags; // See ReplayFlags.
+	uint32_t seed; // Unix timestamp for YRPX. Core duel seed for YRP.
+	uint32_t size; // Uncompressed size of whatever is after this header.
+	uint32_t hash; // Unused.
+	uint8_t props[8]; // Used for LZMA compression (check their apis).
+};
+
+// ***** YRPX Binary format *****
+// ReplayHeader
+// team0Count [uint32_t]
+// team0Names [20 char16_t * team0Count]
+// team1Count [uint32_t]
+// team1Names [20 char16_t * team1Count]
+// duelFlags [uint64_t]
+// Core messages (repeat for number of messages):
+// 	msgType [uint8_t]
+// 	length [uint32_t]
+// 	data [uint8_t * length]
+
+// ***** YRP Binary format *****
+// ReplayHeader
+// team0Count [uint32_t]
+// team0Names [20 char16_t * team0Count]
+// team1Count [uint32_t]
+// team1Names [20 char16_t * team1Count]
+// startingLP [uint32_t]
+// startingDrawCount [uint32_t]
+// drawCountPerTurn [uint32_t]
+// duelFlags [uint64_t]
+// Deck & Extra Decks (repeat for each duelist):
+// 	deckCount [uint32_t]
+// 	cards [uint32_t * deckCount]
+// 	extraCount [uint32_t]
+// 	cards [uint32_t * extraCount]
+// Extra cards:
+// 	count [uint32_t]
+// 	cards [uint32_t * count]
+// Core responses (repeat for number of responses):
+// 	length [uint8_t]
+// 	data [uint8_t * length]
+
+} // namespace YGOPro
+
+#endif // YGOPRO_REPLAYFORMAT_HPP
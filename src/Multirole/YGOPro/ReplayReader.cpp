@@ -0,0 +1,218 @@
+#include "ReplayReader.hpp"
+
+#include <array>
+#include <cstring> // std::memcpy
+#include <stdexcept>
+
+#include <lzma.h>
+
+#include "ReplayFormat.hpp"
+#include "StringUtils.hpp"
+
+namespace YGOPro
+{
+
+namespace
+{
+
+// NOLINTNEXTLINE: Message type, Called OLD_REPLAY_FORMAT in common.h.
+constexpr uint8_t MSG_OLD_REPLAY_FORMAT = 231U;
+
+constexpr std::size_t LZMA_PROPS_SIZE = 5U; // Used bytes of ReplayHeader::props.
+
+// Bounds-checked reading of a replay's data.
+class Reader
+{
+public:
+	Reader(const uint8_t* ptr, std::size_t size) noexcept :
+		ptr(ptr),
+		end(ptr + size)
+	{}
+
+	template<typename T>
+	T Read()
+	{
+		T value{};
+		std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	const uint8_t* Take(std::size_t size)
+	{
+		if(static_cast<std::size_t>(end - ptr) < size)
+			throw std::runtime_error("Replay data is truncated");
+		const uint8_t* p = ptr;
+		ptr += size;
+		return p;
+	}
+
+	bool AtEnd() const noexcept
+	{
+		return ptr == end;
+	}
+private:
+	const uint8_t* ptr;
+	const uint8_t* end;
+};
+
+// Past-the-header data of a replay, uncompressed if needed.
+ReplayReader::Bytes PastHeaderData(const ReplayReader::Bytes& bytes, const ReplayHeader& header)
+{
+	const uint8_t* in = bytes.data() + sizeof(ReplayHeader);
+	const std::size_t inSize = bytes.size() - sizeof(ReplayHeader);
+	if((header.flags & REPLAY_COMPRESSED) == 0U)
+		return ReplayReader::Bytes(in, in + inSize);
+	// NOTE: The data is a raw LZMA stream without end mark, which is what
+	// the legacy .lzma format holds after its header: props and size.
+	std::array<uint8_t, LZMA_PROPS_SIZE + sizeof(uint64_t)> alone{};
+	const uint64_t size = header.size;
+	std::memcpy(alone.data(), header.props, LZMA_PROPS_SIZE);
+	std::memcpy(alone.data() + LZMA_PROPS_SIZE, &size, sizeof(size));
+	ReplayReader::Bytes out(header.size);
+	lzma_stream strm = LZMA_STREAM_INIT;
+	if(lzma_alone_decoder(&strm, UINT64_MAX) != LZMA_OK)
+		throw std::runtime_error("Unable to initialize LZMA decoder");
+	strm.next_out = out.data();
+	strm.avail_out = out.size();
+	strm.next_in = alone.data();
+	strm.avail_in = alone.size();
+	lzma_ret ret = lzma_code(&strm, LZMA_RUN);
+	if(ret == LZMA_OK)
+	{
+		strm.next_in = in;
+		strm.avail_in = inSize;
+		ret = lzma_code(&strm, LZMA_FINISH);
+	}
+	const bool complete = strm.avail_out == 0U;
+	lzma_end(&strm);
+	if((ret != LZMA_OK && ret != LZMA_STREAM_END) || !complete)
+		throw std::runtime_error("Unable to decompress replay");
+	return out;
+}
+
+std::string ReadName(Reader& r)
+{
+	return UTF16ToUTF8(BufferToUTF16(r.Take(40U), 40U));
+}
+
+CodeVector ReadCodeVector(Reader& r)
+{
+	CodeVector codes(r.Read<uint32_t>());
+	for(auto& code : codes)
+		code = r.Read<uint32_t>();
+	return codes;
+}
+
+} // namespace
+
+ReplayReader::ReplayReader(const Bytes& bytes)
+{
+	if(bytes.size() < sizeof(ReplayHeader))
+		throw std::runtime_error("Replay is too small");
+	ReplayHeader header{};
+	std::memcpy(&header, bytes.data(), sizeof(ReplayHeader));
+	if(header.type != REPLAY_YRPX)
+		throw std::runtime_error("Not a YRPX replay");
+	const auto pthData = PastHeaderData(bytes, header);
+	Reader r(pthData.data(), pthData.size());
+	// Skip duelist names, they are read from the YRP replay.
+	for(int team = 0; team < 2; team++)
+		r.Take(40U * r.Read<uint32_t>());
+	r.Read<uint64_t>(); // duelFlags
+	const uint8_t* yrp = nullptr;
+	std::size_t yrpSize = 0U;
+	while(!r.AtEnd())
+	{
+		const auto msgType = r.Read<uint8_t>();
+		const auto length = r.Read<uint32_t>();
+		const uint8_t* data = r.Take(length);
+		if(msgType == MSG_OLD_REPLAY_FORMAT)
+		{
+			yrp = data;
+			yrpSize = length;
+			continue;
+		}
+		auto& msg = messages.emplace_back(1U + length);
+		msg[0U] = msgType;
+		std::memcpy(msg.data() + 1U, data, length);
+	}
+	if(yrp == nullptr)
+		throw std::runtime_error("Replay has no YRP replay embedded");
+	Reader yr(yrp, yrpSize);
+	const auto yrpHeader = yr.Read<ReplayHeader>();
+	if(yrpHeader.type != REPLAY_YRP1 || (yrpHeader.flags & REPLAY_COMPRESSED) != 0U)
+		throw std::runtime_error("Embedded replay is not an uncompressed YRP replay");
+	seed = yrpHeader.seed;
+	for(auto& team : duelists)
+	{
+		team.resize(yr.Read<uint32_t>());
+		for(auto& duelist : team)
+			duelist.name = ReadName(yr);
+	}
+	startingLP = yr.Read<uint32_t>();
+	startingDrawCount = yr.Read<uint32_t>();
+	drawCountPerTurn = yr.Read<uint32_t>();
+	duelFlags = yr.Read<uint64_t>();
+	for(auto& team : duelists)
+	{
+		for(auto& duelist : team)
+		{
+			duelist.main = ReadCodeVector(yr);
+			duelist.extra = ReadCodeVector(yr);
+		}
+	}
+	extraCards = ReadCodeVector(yr);
+	while(!yr.AtEnd())
+	{
+		const auto length = yr.Read<uint8_t>();
+		const uint8_t* data = yr.Take(length);
+		responses.emplace_back(data, data + length);
+	}
+}
+
+uint32_t ReplayReader::Seed() const noexcept
+{
+	return seed;
+}
+
+uint64_t ReplayReader::DuelFlags() const noexcept
+{
+	return duelFlags;
+}
+
+uint32_t ReplayReader::StartingLP() const noexcept
+{
+	return startingLP;
+}
+
+uint32_t ReplayReader::StartingDrawCount() const noexcept
+{
+	return startingDrawCount;
+}
+
+uint32_t ReplayReader::DrawCountPerTurn() const noexcept
+{
+	return drawCountPerTurn;
+}
+
+const std::array<std::vector<Replay::Duelist>, 2U>& ReplayReader::Duelists() const noexcept
+{
+	return duelists;
+}
+
+const CodeVector& ReplayReader::ExtraCards() const noexcept
+{
+	return extraCards;
+}
+
+const std::vector<ReplayReader::Bytes>& ReplayReader::Messages() const noexcept
+{
+	return messages;
+}
+
+const std::vector<ReplayReader::Bytes>& ReplayReader::Responses() const noexcept
+{
+	return responses;
+}
+
+} // namespace YGOPro
@@ -0,0 +1,52 @@
+#ifndef YGOPRO_REPLAYREADER_HPP
+#define YGOPRO_REPLAYREADER_HPP
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Replay.hpp"
+
+namespace YGOPro
+{
+
+// Reads back a binary replay written by Replay, keeping everything needed
+// to play the duel again: the core options, the decks in the order they
+// were given to the core, the recorded messages and the responses.
+class ReplayReader final
+{
+public:
+	using Bytes = std::vector<uint8_t>;
+
+	// Throws std::runtime_error if the bytes are not a YRPX replay with an
+	// embedded YRP replay, or if they are corrupted.
+	explicit ReplayReader(const Bytes& bytes);
+
+	uint32_t Seed() const noexcept;
+	uint64_t DuelFlags() const noexcept;
+	uint32_t StartingLP() const noexcept;
+	uint32_t StartingDrawCount() const noexcept;
+	uint32_t DrawCountPerTurn() const noexcept;
+
+	// Duelists of each team, ordered by their duelist index in the core.
+	const std::array<std::vector<Replay::Duelist>, 2U>& Duelists() const noexcept;
+	const CodeVector& ExtraCards() const noexcept;
+
+	// Core messages as given to Replay::RecordMsg, type included. Does not
+	// include the embedded YRP replay.
+	const std::vector<Bytes>& Messages() const noexcept;
+	const std::vector<Bytes>& Responses() const noexcept;
+private:
+	uint32_t seed;
+	uint64_t duelFlags;
+	uint32_t startingLP;
+	uint32_t startingDrawCount;
+	uint32_t drawCountPerTurn;
+	std::array<std::vector<Replay::Duelist>, 2U> duelists;
+	CodeVector extraCards;
+	std::vector<Bytes> messages;
+	std::vector<Bytes> responses;
+};
+
+} // namespace YGOPro
+
+#endif // YGOPRO_REPLAYREADER_HPP
@@ -0,0 +1,79 @@
+// Extracts replays from a replay archive written by multirole's
+// ReplayManager, as standard .yrpX files.
+//
+// Usage: replay-extractor <archive dir> <output dir> [id...]
+// If no ids are given, all the replays of the archive are extracted.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "../Multirole/ReplayArchive.hpp"
+
+using Ignis::Multirole::ReplayArchive;
+
+bool Extract(
+	const boost::filesystem::path& archiveDir,
+	const boost::filesystem::path& outputDir,
+	const ReplayArchive::Entry& entry)
+{
+	const auto bytes = ReplayArchive::Read(archiveDir, entry);
+	const auto fn = outputDir / (std::to_string(entry.id) + ".yrpX");
+	if(!bytes)
+	{
+		std::fprintf(stderr, "Unable to read replay %s.\n", std::to_string(entry.id).data());
+		return false;
+	}
+	boost::filesystem::ofstream f(fn, std::ios_base::binary);
+	if(!f.is_open() || !f.write(reinterpret_cast<const char*>(bytes->data()), bytes->size()))
+	{
+		std::fprintf(stderr, "Unable to write %s.\n", fn.string().data());
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <archive dir> <output dir> [id...]\n", argv[0]);
+		return 1;
+	}
+	const boost::filesystem::path archiveDir(argv[1]);
+	const boost::filesystem::path outputDir(argv[2]);
+	std::vector<ReplayArchive::Entry> index;
+	try
+	{
+		index = ReplayArchive::ReadIndex(archiveDir);
+		boost::filesystem::create_directories(outputDir);
+	}
+	catch(const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return 2;
+	}
+	bool ok = true;
+	if(argc == 3)
+	{
+		for(const auto& entry : index)
+			ok = Extract(archiveDir, outputDir, entry) && ok;
+		return ok ? 0 : 3;
+	}
+	for(int i = 3; i < argc; i++)
+	{
+		char* end = nullptr;
+		const uint64_t id = std::strtoull(argv[i], &end, 10);
+		const auto* entry = (*end == '\0') ? ReplayArchive::Find(index, id) : nullptr;
+		if(entry == nullptr)
+		{
+			std::fprintf(stderr, "Replay %s not found.\n", argv[i]);
+			ok = false;
+			continue;
+		}
+		ok = Extract(archiveDir, outputDir, *entry) && ok;
+	}
+	return ok ? 0 : 3;
+}
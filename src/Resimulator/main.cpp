@@ -0,0 +1,475 @@
+// Plays the duels of saved replays again against a core, so core updates
+// can be checked for performance regressions and behavior changes before
+// being deployed.
+//
+// Usage: resimulator <shared|hornet> <core> <databases dir> <scripts dir> <replays dir>
+// Card databases (*.cdb) are merged in filename order and scripts (*.lua)
+// are searched recursively. Replays (*.yrpX) must be single files, as
+// written by replay-extractor. Hornet is launched from the working
+// directory, same as multirole does.
+//
+// For each replay prints the wall time taken, the number of calls made to
+// the core and of callbacks made by the core (each one an IPC round trip
+// when using hornet), the number of core messages and, if the duel did not
+// go the same as recorded, the index of the first recorded message that
+// differs.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include "../Multirole/Core/DLWrapper.hpp"
+#include "../Multirole/Core/HornetWrapper.hpp"
+#include "../Multirole/Core/IDataSupplier.hpp"
+#include "../Multirole/Core/ILogger.hpp"
+#include "../Multirole/Core/IScriptSupplier.hpp"
+#include "../Multirole/YGOPro/CardDatabase.hpp"
+#include "../Multirole/YGOPro/Constants.hpp"
+#include "../Multirole/YGOPro/CoreUtils.hpp"
+#include "../Multirole/YGOPro/ReplayReader.hpp"
+
+using namespace Ignis::Multirole;
+using Bytes = std::vector<uint8_t>;
+
+// Forwards every call to the actual core, counting them.
+class CountingWrapper final : public Core::IWrapper
+{
+public:
+	std::size_t calls{0U};
+
+	explicit CountingWrapper(Core::IWrapper& core) : core(core)
+	{}
+
+	std::pair<int, int> Version() override
+	{
+		calls++;
+		return core.Version();
+	}
+
+	Duel CreateDuel(const DuelOptions& opts) override
+	{
+		calls++;
+		return core.CreateDuel(opts);
+	}
+
+	void DestroyDuel(Duel duel) override
+	{
+		calls++;
+		core.DestroyDuel(duel);
+	}
+
+	void AddCard(Duel duel, const NewCardInfo& info) override
+	{
+		calls++;
+		core.AddCard(duel, info);
+	}
+
+	void Start(Duel duel) override
+	{
+		calls++;
+		core.Start(duel);
+	}
+
+	DuelStatus Process(Duel duel) override
+	{
+		calls++;
+		return core.Process(duel);
+	}
+
+	Buffer GetMessages(Duel duel) override
+	{
+		calls++;
+		return core.GetMessages(duel);
+	}
+
+	void SetResponse(Duel duel, const Buffer& buffer) override
+	{
+		calls++;
+		core.SetResponse(duel, buffer);
+	}
+
+	int LoadScript(Duel duel, std::string_view name, std::string_view str) override
+	{
+		calls++;
+		return core.LoadScript(duel, name, str);
+	}
+
+	std::size_t QueryCount(Duel duel, uint8_t team, uint32_t loc) override
+	{
+		calls++;
+		return core.QueryCount(duel, team, loc);
+	}
+
+	Buffer Query(Duel duel, const QueryInfo& info) override
+	{
+		calls++;
+		return core.Query(duel, info);
+	}
+
+	Buffer QueryLocation(Duel duel, const QueryInfo& info) override
+	{
+		calls++;
+		return core.QueryLocation(duel, info);
+	}
+
+	Buffer QueryField(Duel duel) override
+	{
+		calls++;
+		return core.QueryField(duel);
+	}
+private:
+	Core::IWrapper& core;
+};
+
+// Card data from the merged databases, counting the core's requests.
+class DataSupplier final : public Core::IDataSupplier
+{
+public:
+	mutable std::size_t callbacks{0U};
+
+	explicit DataSupplier(const YGOPro::CardDatabase& db) : db(db)
+	{}
+
+	CardData DataFromCode(uint32_t code) const override
+	{
+		callbacks++;
+		return db.DataFromCode(code);
+	}
+
+	void DataUsageDone(const CardData& data) const override
+	{
+		callbacks++;
+		db.DataUsageDone(data);
+	}
+private:
+	const YGOPro::CardDatabase& db;
+};
+
+// Scripts read from disk the first time they are requested.
+class ScriptSupplier final : public Core::IScriptSupplier
+{
+public:
+	mutable std::size_t callbacks{0U};
+
+	explicit ScriptSupplier(const boost::filesystem::path& dir)
+	{
+		using namespace boost::filesystem;
+		for(const auto& de : recursive_directory_iterator(dir))
+			if(is_regular_file(de.path()) && de.path().extension() == ".lua")
+				paths.emplace(de.path().filename().string(), de.path());
+	}
+
+	Script ScriptFromFilePath(std::string_view fp) const noexcept override
+	{
+		callbacks++;
+		if(auto search = scripts.find(fp); search != scripts.end())
+			return search->second;
+		auto contents = std::make_shared<std::string>();
+		if(auto search = paths.find(fp); search != paths.end())
+		{
+			boost::filesystem::ifstream f(search->second, std::ios_base::binary);
+			contents->assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		}
+		return scripts.emplace(std::string(fp), std::move(contents)).first->second;
+	}
+
+	Script BytecodeFromFilePath(std::string_view /*unused*/) const noexcept override
+	{
+		static const auto EMPTY = std::make_shared<const std::string>();
+		return EMPTY;
+	}
+
+	Script BytecodeProbe() const noexcept override
+	{
+		return BytecodeFromFilePath({});
+	}
+private:
+	std::map<std::string, boost::filesystem::path, std::less<>> paths;
+	mutable std::map<std::string, Script, std::less<>> scripts;
+};
+
+// Only counts the errors reported by the core.
+class Logger final : public Core::ILogger
+{
+public:
+	std::size_t errors{0U};
+
+	void Log(LogType type, std::string_view /*unused*/) override
+	{
+		if(type == LogType::LOG_TYPE_ERROR)
+			errors++;
+	}
+};
+
+struct Result
+{
+	std::chrono::microseconds time;
+	std::size_t calls;
+	std::size_t callbacks;
+	std::size_t messages;
+	std::size_t errors;
+	std::optional<std::size_t> divergence;
+};
+
+// Runs the duel the same way Room::Context does, comparing every message
+// that would be recorded with the recorded one.
+Result Resimulate(
+	CountingWrapper& core,
+	DataSupplier& data,
+	ScriptSupplier& scripts,
+	const YGOPro::ReplayReader& replay)
+{
+	using namespace YGOPro::CoreUtils;
+	const auto& recorded = replay.Messages();
+	Result result{};
+	Logger logger;
+	std::size_t next = 0U;
+	auto Record = [&](const Msg& msg)
+	{
+		if(!YGOPro::Replay::IsRecordable(msg))
+			return;
+		if(!result.divergence && (next >= recorded.size() || recorded[next] != msg))
+			result.divergence = next;
+		next++;
+	};
+	auto ProcessQueryRequests = [&](Core::IWrapper::Duel duel, const std::vector<QueryRequest>& qreqs)
+	{
+		for(const auto& reqVar : qreqs)
+		{
+			if(std::holds_alternative<QuerySingleRequest>(reqVar))
+			{
+				const auto& req = std::get<QuerySingleRequest>(reqVar);
+				const Core::IWrapper::QueryInfo qInfo{req.flags, req.con, req.loc, req.seq, 0U};
+				Record(MakeUpdateCardMsg(req.con, req.loc, req.seq, core.Query(duel, qInfo)));
+			}
+			else
+			{
+				const auto& req = std::get<QueryLocationRequest>(reqVar);
+				const Core::IWrapper::QueryInfo qInfo{req.flags, req.con, req.loc, 0U, 0U};
+				Record(MakeUpdateDataMsg(req.con, req.loc, core.QueryLocation(duel, qInfo)));
+			}
+		}
+	};
+	const std::size_t calls = core.calls;
+	const std::size_t callbacks = data.callbacks + scripts.callbacks;
+	const auto start = std::chrono::steady_clock::now();
+	const Core::IWrapper::Player player =
+	{
+		replay.StartingLP(),
+		replay.StartingDrawCount(),
+		replay.DrawCountPerTurn()
+	};
+	const Core::IWrapper::DuelOptions dopts =
+	{
+		data,
+		scripts,
+		&logger,
+		replay.Seed(),
+		replay.DuelFlags(),
+		player,
+		player
+	};
+	auto duel = core.CreateDuel(dopts);
+	for(const auto* file : {"constant.lua", "utility.lua"})
+		if(auto scr = scripts.ScriptFromFilePath(file); !scr->empty())
+			core.LoadScript(duel, file, *scr);
+	OCG_NewCardInfo nci{};
+	nci.pos = POS_FACEDOWN_DEFENSE;
+	for(auto code : replay.ExtraCards())
+	{
+		nci.code = code;
+		core.AddCard(duel, nci);
+	}
+	for(uint8_t team = 0U; team < 2U; team++)
+	{
+		for(std::size_t i = 0U; i < replay.Duelists()[team].size(); i++)
+		{
+			const auto& duelist = replay.Duelists()[team][i];
+			nci.team = nci.con = team;
+			nci.duelist = static_cast<uint8_t>(i);
+			nci.loc = LOCATION_DECK;
+			for(auto code : duelist.main)
+			{
+				nci.code = code;
+				core.AddCard(duel, nci);
+			}
+			nci.loc = LOCATION_EXTRA;
+			for(auto code : duelist.extra)
+			{
+				nci.code = code;
+				core.AddCard(duel, nci);
+			}
+		}
+	}
+	core.Start(duel);
+	Record(MakeStartMsg(
+		{
+			replay.StartingLP(),
+			core.QueryCount(duel, 0U, LOCATION_DECK),
+			core.QueryCount(duel, 0U, LOCATION_EXTRA),
+			core.QueryCount(duel, 1U, LOCATION_DECK),
+			core.QueryCount(duel, 1U, LOCATION_EXTRA),
+		}));
+	for(uint8_t team = 0U; team < 2U; team++)
+		ProcessQueryRequests(duel, {QueryLocationRequest{team, LOCATION_DECK, 0x1181FFF}});
+	for(uint8_t team = 0U; team < 2U; team++)
+		ProcessQueryRequests(duel, {QueryLocationRequest{team, LOCATION_EXTRA, 0x381FFF}});
+	const auto& responses = replay.Responses();
+	std::size_t response = 0U;
+	for(bool finished = false; !finished;)
+	{
+		Core::IWrapper::DuelStatus status{};
+		do
+		{
+			status = core.Process(duel);
+			for(const auto& msg : SplitToMsgs(core.GetMessages(duel)))
+			{
+				result.messages++;
+				const uint8_t msgType = GetMessageType(msg);
+				if(msgType == MSG_RETRY)
+				{
+					// A recorded response was rejected.
+					if(!result.divergence)
+						result.divergence = next;
+					finished = true;
+					break;
+				}
+				ProcessQueryRequests(duel, GetPreDistQueryRequests(msg));
+				Record(msg);
+				ProcessQueryRequests(duel, GetPostDistQueryRequests(msg));
+				if(msgType == MSG_WIN)
+					finished = true;
+			}
+		}
+		while(!finished && status == Core::IWrapper::DuelStatus::DUEL_STATUS_CONTINUE);
+		// NOTE: Duels that were not won (e.g: surrendered) just run out of
+		// responses.
+		if(finished || status == Core::IWrapper::DuelStatus::DUEL_STATUS_END ||
+		   response == responses.size())
+			break;
+		core.SetResponse(duel, responses[response++]);
+	}
+	// Recorded messages left over mean the duel ended early, except for the
+	// win message the server records when a duelist surrenders, times out
+	// or disconnects, which the core never sends.
+	auto IsServerWin = [&](const Bytes& msg)
+	{
+		if(msg.size() < 3U || GetMessageType(msg) != MSG_WIN)
+			return false;
+		return msg[2U] == WIN_REASON_SURRENDERED ||
+		       msg[2U] == WIN_REASON_TIMED_OUT ||
+		       msg[2U] == WIN_REASON_CONNECTION_LOST;
+	};
+	if(!result.divergence && next < recorded.size() &&
+	   !(next + 1U == recorded.size() && IsServerWin(recorded[next])))
+		result.divergence = next;
+	core.DestroyDuel(duel);
+	result.time = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start);
+	result.calls = core.calls - calls;
+	result.callbacks = data.callbacks + scripts.callbacks - callbacks;
+	result.errors = logger.errors;
+	return result;
+}
+
+std::vector<boost::filesystem::path> ListFiles(const boost::filesystem::path& dir, const char* extension)
+{
+	std::vector<boost::filesystem::path> files;
+	for(const auto& de : boost::filesystem::directory_iterator(dir))
+		if(is_regular_file(de.path()) && de.path().extension() == extension)
+			files.emplace_back(de.path());
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+Bytes ReadFile(const boost::filesystem::path& fn)
+{
+	boost::filesystem::ifstream f(fn, std::ios_base::binary);
+	return Bytes(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 6)
+	{
+		std::fprintf(stderr,
+			"Usage: %s <shared|hornet> <core> <databases dir> <scripts dir> <replays dir>\n",
+			argv[0]);
+		return 1;
+	}
+	const std::string_view coreType(argv[1]);
+	std::unique_ptr<YGOPro::CardDatabase> db;
+	std::unique_ptr<ScriptSupplier> scripts;
+	std::unique_ptr<Core::DLWrapper> dlCore;
+	std::unique_ptr<Core::HornetWrapper> hCore;
+	std::vector<boost::filesystem::path> replays;
+	try
+	{
+		std::vector<YGOPro::CardDatabase::CardSetPtr> sets;
+		for(const auto& fn : ListFiles(argv[3], ".cdb"))
+			if(auto set = YGOPro::CardDatabase::ReadSet(fn.string()); set)
+				sets.emplace_back(std::move(set));
+			else
+				std::fprintf(stderr, "Unable to read %s.\n", fn.string().data());
+		db = std::make_unique<YGOPro::CardDatabase>(sets);
+		scripts = std::make_unique<ScriptSupplier>(argv[4]);
+		replays = ListFiles(argv[5], ".yrpX");
+		const auto corePath = boost::filesystem::absolute(argv[2]).string();
+		if(coreType == "shared")
+			dlCore = std::make_unique<Core::DLWrapper>(corePath);
+		else if(coreType == "hornet")
+			hCore = std::make_unique<Core::HornetWrapper>(corePath);
+		else
+			throw std::runtime_error("Core type must be either shared or hornet");
+	}
+	catch(const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return 2;
+	}
+	CountingWrapper core(dlCore ? static_cast<Core::IWrapper&>(*dlCore) : *hCore);
+	DataSupplier data(*db);
+	const auto version = core.Version();
+	std::printf("Core version %d.%d, %zu cards, %zu replays.\n",
+		version.first, version.second, db->Size(), replays.size());
+	Result total{};
+	std::size_t diverged = 0U;
+	std::size_t failed = 0U;
+	for(const auto& fn : replays)
+	{
+		const auto name = fn.filename().string();
+		try
+		{
+			const YGOPro::ReplayReader replay(ReadFile(fn));
+			const auto r = Resimulate(core, data, *scripts, replay);
+			std::printf("%s: %.3f ms, %zu calls, %zu callbacks, %zu messages, %zu errors",
+				name.data(), r.time.count() / 1000.0, r.calls, r.callbacks, r.messages, r.errors);
+			if(r.divergence)
+				std::printf(", diverged at message %zu of %zu", *r.divergence, replay.Messages().size());
+			std::printf("\n");
+			total.time += r.time;
+			total.calls += r.calls;
+			total.callbacks += r.callbacks;
+			total.messages += r.messages;
+			total.errors += r.errors;
+			diverged += r.divergence ? 1U : 0U;
+		}
+		catch(const std::exception& e)
+		{
+			std::printf("%s: failed, %s\n", name.data(), e.what());
+			failed++;
+		}
+	}
+	std::printf("Total: %.3f ms, %zu calls, %zu callbacks, %zu messages, %zu errors, "
+		"%zu diverged, %zu failed.\n",
+		total.time.count() / 1000.0, total.calls, total.callbacks, total.messages,
+		total.errors, diverged, failed);
+	return (diverged == 0U && failed == 0U) ? 0 : 3;
+}
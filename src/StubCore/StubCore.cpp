@@ -0,0 +1,497 @@
+// Stand-in for libocgcore that plays a synthetic duel instead of running
+// any rules or scripts, so benchmarks measure everything but the core:
+// multirole's own message handling (splitting, stripping, queries and
+// broadcasting) and, when loaded by hornet, the IPC transport.
+//
+// Each duel is a fixed pattern of turns. Every turn starts with MSG_NEW_TURN,
+// MSG_NEW_PHASE and MSG_DRAW, followed by a number of requests, each one
+// preceded by MSG_MOVE and MSG_CONFIRM_CARDS messages (alternating) and by
+// a hint. Requests are always MSG_SELECT_IDLECMD and any response is
+// accepted. Once all turns are played the first player wins.
+//
+// Card data is read and a script is requested once per distinct card code
+// when cards are added, like the real core does, plus a number of reads per
+// request. The pattern is set through environment variables, read once:
+//	* OCGSTUB_TURNS: Turns per duel (20).
+//	* OCGSTUB_REQUESTS_PER_TURN: Requests per turn (8).
+//	* OCGSTUB_MESSAGES_PER_REQUEST: Messages before each request (8, max 64).
+//	* OCGSTUB_MESSAGE_SIZE: Approximate size in bytes of each MSG_CONFIRM_CARDS
+//	  (64, max 1024).
+//	* OCGSTUB_CARD_READS_PER_REQUEST: Card data reads per request (4).
+//	* OCGSTUB_SCRIPT_READS_PER_REQUEST: Script reads per request (1).
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../ocgapi_types.h"
+#include "../Multirole/YGOPro/Constants.hpp"
+
+#ifdef _WIN32
+#define OCGSTUB_EXPORT __declspec(dllexport)
+#else
+#define OCGSTUB_EXPORT __attribute__((visibility("default")))
+#endif // _WIN32
+
+#define OCGFUNC(ret, name, args) extern "C" OCGSTUB_EXPORT ret name args;
+#include "../ocgapi_funcs.inl"
+#undef OCGFUNC
+
+namespace
+{
+
+#include "../Write.inl"
+
+constexpr uint8_t HINT_SELECTMSG = 3U;
+constexpr uint16_t PHASE_DRAW = 0x1U;
+constexpr std::size_t MZONE_SLOTS = 7U;
+constexpr std::size_t SZONE_SLOTS = 8U;
+constexpr std::size_t CONFIRMED_CARD_SIZE = 4U + 1U + 1U + 4U;
+
+struct Config
+{
+	uint32_t turns;
+	uint32_t requestsPerTurn;
+	uint32_t messagesPerRequest;
+	uint32_t messageSize;
+	uint32_t cardReadsPerRequest;
+	uint32_t scriptReadsPerRequest;
+};
+
+uint32_t EnvOr(const char* name, uint32_t value, uint32_t max = UINT32_MAX)
+{
+	if(const char* str = std::getenv(name); str != nullptr)
+		value = static_cast<uint32_t>(std::strtoul(str, nullptr, 10));
+	return std::min(value, max);
+}
+
+const Config& GetConfig()
+{
+	static const Config config
+	{
+		std::max(EnvOr("OCGSTUB_TURNS", 20U), 1U),
+		std::max(EnvOr("OCGSTUB_REQUESTS_PER_TURN", 8U), 1U),
+		EnvOr("OCGSTUB_MESSAGES_PER_REQUEST", 8U, 64U),
+		EnvOr("OCGSTUB_MESSAGE_SIZE", 64U, 1024U),
+		EnvOr("OCGSTUB_CARD_READS_PER_REQUEST", 4U),
+		EnvOr("OCGSTUB_SCRIPT_READS_PER_REQUEST", 1U)
+	};
+	return config;
+}
+
+struct Duel
+{
+	OCG_DuelOptions opts;
+	std::array<std::vector<uint32_t>, 2U> deck;
+	std::array<std::vector<uint32_t>, 2U> extra;
+	std::array<std::vector<uint32_t>, 2U> hand;
+	std::array<std::vector<uint32_t>, 2U> grave;
+	std::vector<uint32_t> codes; // Every distinct code, for the callbacks.
+	std::vector<uint8_t> messages;
+	std::vector<uint8_t> buffer; // Last buffer returned to the caller.
+	std::vector<uint8_t> response;
+	uint32_t turn{0U};
+	uint32_t request{0U};
+	std::size_t nextCode{0U};
+	bool ended{false};
+
+	uint8_t Player() const
+	{
+		return static_cast<uint8_t>((turn + 1U) % 2U);
+	}
+
+	uint32_t NextCode()
+	{
+		if(codes.empty())
+			return 0U;
+		return codes[nextCode++ % codes.size()];
+	}
+
+	// Code and position of the cards on a location, code 0 for empty zones.
+	// Monster and spell/trap zones fill up as turns go by.
+	std::vector<std::pair<uint32_t, uint32_t>> Cards(uint8_t con, uint32_t loc) const
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> cards;
+		auto AddAll = [&](const std::vector<uint32_t>& codes, uint32_t pos)
+		{
+			for(auto code : codes)
+				cards.emplace_back(code, pos);
+		};
+		auto AddZones = [&](std::size_t slots, std::size_t occupied)
+		{
+			const auto& d = deck[con];
+			for(std::size_t i = 0U; i < slots; i++)
+				cards.emplace_back((i < occupied && !d.empty()) ? d[i % d.size()] : 0U, POS_FACEUP_ATTACK);
+		};
+		switch(loc)
+		{
+		case LOCATION_DECK: AddAll(deck[con], POS_FACEDOWN_DEFENSE); break;
+		case LOCATION_EXTRA: AddAll(extra[con], POS_FACEDOWN_DEFENSE); break;
+		case LOCATION_HAND: AddAll(hand[con], POS_FACEDOWN_DEFENSE); break;
+		case LOCATION_GRAVE: AddAll(grave[con], POS_FACEUP_ATTACK); break;
+		case LOCATION_MZONE: AddZones(MZONE_SLOTS, std::min<std::size_t>(turn, 3U)); break;
+		case LOCATION_SZONE: AddZones(SZONE_SLOTS, std::min<std::size_t>(turn, 2U)); break;
+		default: break;
+		}
+		return cards;
+	}
+};
+
+inline Duel& AsDuel(OCG_Duel duel)
+{
+	return *static_cast<Duel*>(duel);
+}
+
+// Appends a message, prefixed by its length, to the pending messages.
+template<typename F>
+void AddMsg(Duel& d, std::size_t size, F&& write)
+{
+	const std::size_t offset = d.messages.size();
+	d.messages.resize(offset + sizeof(uint32_t) + size);
+	uint8_t* ptr = d.messages.data() + offset;
+	Write(ptr, static_cast<uint32_t>(size));
+	write(ptr);
+}
+
+void WriteLocInfo(uint8_t*& ptr, uint8_t con, uint8_t loc, uint32_t seq, uint32_t pos)
+{
+	Write<uint8_t>(ptr, con);
+	Write<uint8_t>(ptr, loc);
+	Write<uint32_t>(ptr, seq);
+	Write<uint32_t>(ptr, pos);
+}
+
+// Writes the query of a single card as the core would, only with the fields
+// multirole understands and in the same order. Empty zones are a single zero
+// length.
+void WriteQuery(std::vector<uint8_t>& out, uint32_t flags, uint32_t code, uint32_t pos)
+{
+	auto Append = [&out](auto value)
+	{
+		const std::size_t offset = out.size();
+		out.resize(offset + sizeof(value));
+		std::memcpy(out.data() + offset, &value, sizeof(value));
+	};
+	if(code == 0U)
+	{
+		Append(uint16_t{0U});
+		return;
+	}
+	auto Field = [&](uint32_t flag, auto value)
+	{
+		if((flags & flag) == 0U)
+			return;
+		Append(static_cast<uint16_t>(sizeof(flag) + sizeof(value)));
+		Append(flag);
+		Append(value);
+	};
+	Field(QUERY_CODE, code);
+	Field(QUERY_POSITION, pos);
+	Field(QUERY_ALIAS, uint32_t{0U});
+	Field(QUERY_TYPE, uint32_t{0x21U}); // Effect monster.
+	Field(QUERY_LEVEL, uint32_t{4U});
+	Field(QUERY_RANK, uint32_t{0U});
+	Field(QUERY_ATTRIBUTE, uint32_t{0x20U});
+	Field(QUERY_RACE, uint32_t{0x1U});
+	Field(QUERY_ATTACK, int32_t{1800});
+	Field(QUERY_DEFENSE, int32_t{1000});
+	Field(QUERY_BASE_ATTACK, int32_t{1800});
+	Field(QUERY_BASE_DEFENSE, int32_t{1000});
+	Field(QUERY_REASON, uint32_t{0U});
+	Field(QUERY_OWNER, uint8_t{0U});
+	Field(QUERY_STATUS, uint32_t{0U});
+	Field(QUERY_IS_PUBLIC, uint8_t{0U});
+	Field(QUERY_LSCALE, uint32_t{0U});
+	Field(QUERY_RSCALE, uint32_t{0U});
+	if((flags & QUERY_LINK) != 0U)
+	{
+		Append(static_cast<uint16_t>(sizeof(uint32_t) * 3U));
+		Append(uint32_t{QUERY_LINK});
+		Append(uint32_t{0U});
+		Append(uint32_t{0U});
+	}
+	Field(QUERY_IS_HIDDEN, uint8_t{0U});
+	Field(QUERY_COVER, uint32_t{0U});
+	Append(static_cast<uint16_t>(sizeof(uint32_t)));
+	Append(uint32_t{QUERY_END});
+}
+
+void ReadCardData(Duel& d, uint32_t code)
+{
+	const auto& o = d.opts;
+	OCG_CardData data{};
+	o.cardReader(o.payload1, code, &data);
+	if(o.cardReaderDone != nullptr)
+		o.cardReaderDone(o.payload4, &data);
+}
+
+void ReadScript(Duel& d, OCG_Duel duel, uint32_t code)
+{
+	const auto& o = d.opts;
+	char name[24U];
+	std::snprintf(name, sizeof(name), "c%u.lua", code);
+	o.scriptReader(o.payload2, duel, name);
+}
+
+void AddMove(Duel& d, uint8_t player, bool toHand)
+{
+	auto& from = toHand ? d.deck[player] : d.hand[player];
+	auto& to = toHand ? d.hand[player] : d.grave[player];
+	const uint32_t code = from.empty() ? d.NextCode() : from.back();
+	const auto seq = static_cast<uint32_t>(from.empty() ? 0U : from.size() - 1U);
+	if(!from.empty())
+		from.pop_back();
+	AddMsg(d, 1U + 4U + 10U + 10U + 4U, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_MOVE);
+		Write<uint32_t>(ptr, code);
+		if(toHand)
+		{
+			WriteLocInfo(ptr, player, LOCATION_DECK, seq, POS_FACEDOWN_DEFENSE);
+			WriteLocInfo(ptr, player, LOCATION_HAND, static_cast<uint32_t>(to.size()), POS_FACEDOWN_DEFENSE);
+		}
+		else
+		{
+			WriteLocInfo(ptr, player, LOCATION_HAND, seq, POS_FACEDOWN_DEFENSE);
+			WriteLocInfo(ptr, player, LOCATION_GRAVE, static_cast<uint32_t>(to.size()), POS_FACEUP_ATTACK);
+		}
+		Write<uint32_t>(ptr, 0U); // Reason
+	});
+	to.push_back(code);
+}
+
+void AddConfirmCards(Duel& d, uint8_t player)
+{
+	const std::size_t count = std::max<std::size_t>(
+		(GetConfig().messageSize - std::min<std::size_t>(GetConfig().messageSize, 6U)) / CONFIRMED_CARD_SIZE, 1U);
+	AddMsg(d, 1U + 1U + 4U + count * CONFIRMED_CARD_SIZE, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_CONFIRM_CARDS);
+		Write<uint8_t>(ptr, player);
+		Write(ptr, static_cast<uint32_t>(count));
+		for(std::size_t i = 0U; i < count; i++)
+		{
+			Write<uint32_t>(ptr, d.NextCode());
+			Write<uint8_t>(ptr, player);
+			Write<uint8_t>(ptr, LOCATION_HAND);
+			Write(ptr, static_cast<uint32_t>(i));
+		}
+	});
+}
+
+void AddNewTurn(Duel& d)
+{
+	d.turn++;
+	d.request = 0U;
+	const uint8_t player = d.Player();
+	AddMsg(d, 2U, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_NEW_TURN);
+		Write<uint8_t>(ptr, player);
+	});
+	AddMsg(d, 3U, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_NEW_PHASE);
+		Write<uint16_t>(ptr, PHASE_DRAW);
+	});
+	auto& deck = d.deck[player];
+	const uint32_t code = deck.empty() ? d.NextCode() : deck.back();
+	if(!deck.empty())
+		deck.pop_back();
+	d.hand[player].push_back(code);
+	AddMsg(d, 1U + 1U + 4U + 4U + 4U, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_DRAW);
+		Write<uint8_t>(ptr, player);
+		Write<uint32_t>(ptr, 1U);
+		Write<uint32_t>(ptr, code);
+		Write<uint32_t>(ptr, POS_FACEDOWN_DEFENSE);
+	});
+}
+
+void AddRequest(Duel& d)
+{
+	const uint8_t player = d.Player();
+	AddMsg(d, 1U + 1U + 1U + 8U, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_HINT);
+		Write<uint8_t>(ptr, HINT_SELECTMSG);
+		Write<uint8_t>(ptr, player);
+		Write<uint64_t>(ptr, 0U);
+	});
+	// NOTE: An idle command with nothing to do but ending the turn. Card
+	// counts for summon, special summon, reposition, monster set, spell set
+	// and activate, followed by toBP<1>, toEP<1> and canShuffle<1>.
+	constexpr std::size_t COUNTS = 6U;
+	AddMsg(d, 1U + 1U + COUNTS * sizeof(uint32_t) + 3U, [&](uint8_t*& ptr)
+	{
+		Write<uint8_t>(ptr, MSG_SELECT_IDLECMD);
+		Write<uint8_t>(ptr, player);
+		std::memset(ptr, 0, COUNTS * sizeof(uint32_t) + 3U);
+	});
+	d.request++;
+}
+
+} // namespace
+
+void OCG_GetVersion(int* major, int* minor)
+{
+	*major = OCG_VERSION_MAJOR;
+	*minor = OCG_VERSION_MINOR;
+}
+
+int OCG_CreateDuel(OCG_Duel* duel, OCG_DuelOptions options)
+{
+	if(options.cardReader == nullptr)
+		return OCG_DUEL_CREATION_NULL_DATA_READER;
+	if(options.scriptReader == nullptr)
+		return OCG_DUEL_CREATION_NULL_SCRIPT_READER;
+	GetConfig();
+	auto* d = new Duel();
+	d->opts = options;
+	*duel = d;
+	return OCG_DUEL_CREATION_SUCCESS;
+}
+
+void OCG_DestroyDuel(OCG_Duel duel)
+{
+	delete static_cast<Duel*>(duel);
+}
+
+void OCG_DuelNewCard(OCG_Duel duel, OCG_NewCardInfo info)
+{
+	auto& d = AsDuel(duel);
+	const uint8_t con = info.con & 1U;
+	if(info.loc == LOCATION_DECK)
+		d.deck[con].push_back(info.code);
+	else if(info.loc == LOCATION_EXTRA)
+		d.extra[con].push_back(info.code);
+	ReadCardData(d, info.code);
+	if(std::find(d.codes.begin(), d.codes.end(), info.code) == d.codes.end())
+	{
+		d.codes.push_back(info.code);
+		ReadScript(d, duel, info.code);
+	}
+}
+
+int OCG_StartDuel(OCG_Duel /*duel*/)
+{
+	return 0;
+}
+
+int OCG_DuelProcess(OCG_Duel duel)
+{
+	auto& d = AsDuel(duel);
+	const auto& cfg = GetConfig();
+	if(d.ended)
+		return OCG_DUEL_STATUS_END;
+	if(d.turn == 0U || d.request == cfg.requestsPerTurn)
+	{
+		if(d.turn == cfg.turns)
+		{
+			AddMsg(d, 3U, [&](uint8_t*& ptr)
+			{
+				Write<uint8_t>(ptr, MSG_WIN);
+				Write<uint8_t>(ptr, 0U);
+				Write<uint8_t>(ptr, 0U);
+			});
+			d.ended = true;
+			return OCG_DUEL_STATUS_END;
+		}
+		AddNewTurn(d);
+	}
+	for(uint32_t i = 0U; i < cfg.cardReadsPerRequest; i++)
+		ReadCardData(d, d.NextCode());
+	for(uint32_t i = 0U; i < cfg.scriptReadsPerRequest; i++)
+		ReadScript(d, duel, d.NextCode());
+	for(uint32_t i = 0U; i < cfg.messagesPerRequest; i++)
+	{
+		if(i % 2U == 0U)
+			AddMove(d, d.Player(), (i % 4U) == 0U);
+		else
+			AddConfirmCards(d, d.Player());
+	}
+	AddRequest(d);
+	return OCG_DUEL_STATUS_AWAITING;
+}
+
+void* OCG_DuelGetMessage(OCG_Duel duel, uint32_t* length)
+{
+	auto& d = AsDuel(duel);
+	d.buffer.swap(d.messages);
+	d.messages.clear();
+	*length = static_cast<uint32_t>(d.buffer.size());
+	return d.buffer.data();
+}
+
+void OCG_DuelSetResponse(OCG_Duel duel, const void* buffer, uint32_t length)
+{
+	auto& d = AsDuel(duel);
+	const auto* bytes = static_cast<const uint8_t*>(buffer);
+	d.response.assign(bytes, bytes + length);
+}
+
+int OCG_LoadScript(OCG_Duel /*duel*/, const char* /*buffer*/, uint32_t /*length*/, const char* /*name*/)
+{
+	return 1;
+}
+
+uint32_t OCG_DuelQueryCount(OCG_Duel duel, uint8_t team, uint32_t loc)
+{
+	const auto cards = AsDuel(duel).Cards(team & 1U, loc);
+	return static_cast<uint32_t>(std::count_if(cards.begin(), cards.end(), [](const auto& c)
+	{
+		return c.first != 0U;
+	}));
+}
+
+void* OCG_DuelQuery(OCG_Duel duel, uint32_t* length, OCG_QueryInfo info)
+{
+	auto& d = AsDuel(duel);
+	const auto cards = d.Cards(info.con & 1U, info.loc);
+	d.buffer.clear();
+	if(info.seq < cards.size())
+		WriteQuery(d.buffer, info.flags, cards[info.seq].first, cards[info.seq].second);
+	else
+		WriteQuery(d.buffer, info.flags, 0U, 0U);
+	*length = static_cast<uint32_t>(d.buffer.size());
+	return d.buffer.data();
+}
+
+void* OCG_DuelQueryLocation(OCG_Duel duel, uint32_t* length, OCG_QueryInfo info)
+{
+	auto& d = AsDuel(duel);
+	d.buffer.assign(sizeof(uint32_t), 0U);
+	for(const auto& c : d.Cards(info.con & 1U, info.loc))
+		WriteQuery(d.buffer, info.flags, c.first, c.second);
+	const auto size = static_cast<uint32_t>(d.buffer.size() - sizeof(uint32_t));
+	std::memcpy(d.buffer.data(), &size, sizeof(size));
+	*length = static_cast<uint32_t>(d.buffer.size());
+	return d.buffer.data();
+}
+
+// NOTE: Not used by multirole, only the LP and the card counts of each
+// location are written.
+void* OCG_DuelQueryField(OCG_Duel duel, uint32_t* length)
+{
+	auto& d = AsDuel(duel);
+	d.buffer.clear();
+	for(uint8_t con = 0U; con < 2U; con++)
+	{
+		const auto& player = (con == 0U) ? d.opts.team1 : d.opts.team2;
+		for(uint32_t v : {player.startingLP,
+			static_cast<uint32_t>(d.deck[con].size()),
+			static_cast<uint32_t>(d.hand[con].size()),
+			static_cast<uint32_t>(d.grave[con].size()),
+			static_cast<uint32_t>(d.extra[con].size())})
+		{
+			const std::size_t offset = d.buffer.size();
+			d.buffer.resize(offset + sizeof(v));
+			std::memcpy(d.buffer.data() + offset, &v, sizeof(v));
+		}
+	}
+	*length = static_cast<uint32_t>(d.buffer.size());
+	return d.buffer.data();
+}
@@ -15,6 +15,12 @@ forwarded to the currently running server instance, and after a small grace
 period this script will automatically launch another server executable,
 resuming the waiting process described previously.
 
+If USE_HANDOFF is set (requires `handoff` to be enabled in Multirole's config)
+the currently running instance is not signaled, instead, a new instance is
+launched right away, which takes over the listening sockets (webhooks included)
+of the current one, making it stop accepting connections and exit once its
+duels are finished.
+
 This script is never meant to exit gracefully, therefore if you want to
 terminate it, signal the process with SIGKILL (which cannot be caught),
 this will relinquish the ownership of the currently running server instance
@@ -29,6 +35,7 @@ import signal
 
 MULTIROLE_EXEC = './multirole'
 SIGNALING_PERIOD_IN_SECONDS = 3
+USE_HANDOFF = False
 POLL_RATE_IN_SECONDS = 1
 
 def TPrint(s):
@@ -38,6 +45,7 @@ class AreaZero():
 	def __init__(self):
 		self.process = None
 		self.wait_task = None
+		self.previous = set()
 
 	async def Start(self):
 		await self.Launch()
@@ -60,7 +68,22 @@ class AreaZero():
 		except asyncio.exceptions.CancelledError:
 			pass
 
+	async def Reap(self, process):
+		await process.wait()
+		self.previous.discard(process)
+
+	async def Handoff(self): # NOTE: Assumes that self.Start() was called before.
+		TPrint('Launching successor...')
+		self.wait_task.cancel()
+		previous = self.process
+		self.previous.add(previous)
+		asyncio.create_task(self.Reap(previous))
+		await self.Start()
+
 	async def Signal(self): # NOTE: Assumes that self.Start() was called before.
+		if USE_HANDOFF:
+			await self.Handoff()
+			return
 		TPrint('Signaling multirole...')
 		self.wait_task.cancel()
 		self.process.send_signal(signal.SIGTERM)